@@ -0,0 +1,239 @@
+#ifndef PID_AutoTune_h
+#define PID_AutoTune_h
+
+#if ARDUINO >= 100
+  #include "Arduino.h"
+#else
+  #include "WProgram.h"
+#endif
+
+#include <math.h>
+#include "PID_v1.h"
+
+//tuning rules for Start()
+#define PID_TUNE_ZN_PID 0               // Ziegler-Nichols, fast but with overshoot
+#define PID_TUNE_ZN_PI 1
+#define PID_TUNE_TL_PID 2               // Tyreus-Luyben, slower and much better damped
+#define PID_TUNE_TL_PI 3
+
+//states returned by Runtime()
+#define PID_TUNE_IDLE 0
+#define PID_TUNE_RUNNING 1
+#define PID_TUNE_DONE 2
+#define PID_TUNE_FAILED 3
+
+/**********************************************************************************
+ * BasicPIDAutoTune<Scalar>, PIDAutoTune
+ *
+ *    a relay autotuner (Astrom-Hagglund).  it takes the PID out of AUTOMATIC
+ *  and switches its Output between Center+Step and Center-Step (both kept within
+ *  the PID's output limits) whenever the Input crosses the setpoint, which makes
+ *  the process oscillate.  from the period Pu and the amplitude a of that
+ *  oscillation it gets the ultimate gain Ku = 4*d/(pi*sqrt(a^2 - Hysteresis^2)),
+ *  d being half the distance between the two outputs, and from those the
+ *  tunings, which are handed to SetTunings() before the PID goes back into the
+ *  mode it was in.  the time is taken from the PID's clock (SetTimeSource()).
+ *
+ *      PIDAutoTune tuner(&myPID, &Input, &Output);
+ *      tuner.Start(Setpoint, 50, 1);        //Output +-50 around its current value
+ *      ...  in loop(), instead of myPID.Compute():
+ *      if (tuner.Runtime() != PID_TUNE_RUNNING) myPID.Compute();
+ *
+ *  Runtime() doesn't block: it looks at the Input once per call, keeps track of
+ *  the peaks of the current half cycle and only does the math after the relay
+ *  switched.  the experiment ends when two full cycles in a row agree on period
+ *  and amplitude to within 5%.  it fails after MaxCycles cycles, or when the
+ *  relay hasn't switched for the timeout (e.g. because the Step is too small to
+ *  get the Input across the setpoint, or the actuator is dead).
+ *  the Hysteresis should be a bit above the noise on the Input.
+ **********************************************************************************/
+template<class Scalar>
+class BasicPIDAutoTune
+{
+public:
+  enum { MaxCycles = 20 };
+
+  BasicPIDAutoTune(BasicPID<Scalar>*, Scalar*, Scalar*);  // * the PID to tune and its Input and Output
+
+  void Start(Scalar Setpoint, Scalar Step,  // * starts the relay experiment around Setpoint, with
+      Scalar Hysteresis,                    //   the Output swinging +-Step around where it is now
+      int Rule = PID_TUNE_ZN_PID);
+  int Runtime();                        // * call every loop(), returns one of the states above
+  void Cancel();                        // * stops the experiment, restoring Output and PID mode
+  void SetTimeout(unsigned int);        // * fails when the relay doesn't switch for this many seconds.
+                                        //   default 1200, at most 4000 (the clock wraps after 71 min)
+
+  int GetState() { return state; }
+  double GetKu() { return ku; }         // * ultimate gain and period (seconds) of the last
+  double GetPu() { return pu; }         //   successful experiment
+
+private:
+  void Finish(int);
+
+  BasicPID<Scalar> *pid;
+  Scalar *myInput;
+  Scalar *myOutput;
+  Scalar setpoint, hysteresis, center;
+  Scalar outHigh, outLow;               // the two relay outputs
+  Scalar peakHigh, peakLow;             // extremes of the current half cycles
+  double lastAmplitude, ku, pu;
+  unsigned long lastRise;               // PID time (us) of the last switch to the high output
+  unsigned long lastPeriod;
+  unsigned long lastSwitch;
+  unsigned long timeout;                // in Microseconds
+  uint8_t cycles;
+  uint8_t state;
+  uint8_t rule;
+  bool high;                            // relay is at outHigh
+  bool reverse;
+  bool wasAuto;
+};
+
+typedef BasicPIDAutoTune<double> PIDAutoTune;
+
+template<class Scalar>
+BasicPIDAutoTune<Scalar>::BasicPIDAutoTune(BasicPID<Scalar> *PID, Scalar *Input, Scalar *Output)
+{
+   pid = PID;
+   myInput = Input;
+   myOutput = Output;
+   state = PID_TUNE_IDLE;
+   ku = pu = 0;
+   timeout = 1200UL * 1000000UL;
+}
+
+template<class Scalar>
+void BasicPIDAutoTune<Scalar>::SetTimeout(unsigned int Seconds)
+{
+   if (Seconds > 0 && Seconds <= 4000) timeout = Seconds * 1000000UL;
+}
+
+template<class Scalar>
+void BasicPIDAutoTune<Scalar>::Start(Scalar Setpoint, Scalar Step, Scalar Hysteresis, int Rule)
+{
+   if (state == PID_TUNE_RUNNING || Step <= Scalar(0) || Hysteresis < Scalar(0)) return;
+   Scalar up = *myOutput + Step, down = *myOutput - Step;
+   if (up > pid->GetOutputMax()) up = pid->GetOutputMax();
+   if (down < pid->GetOutputMin()) down = pid->GetOutputMin();
+   if (up <= down) return;
+   setpoint = Setpoint;
+   hysteresis = Hysteresis;
+   rule = Rule;
+   center = *myOutput;
+   outHigh = up;
+   outLow = down;
+   reverse = pid->GetDirection() == REVERSE;
+   wasAuto = pid->GetMode() == AUTOMATIC;
+   pid->SetMode(MANUAL);
+
+   //start by pushing the Input towards the setpoint
+   high = (*myInput < setpoint) != reverse;
+   *myOutput = high ? outHigh : outLow;
+   peakHigh = peakLow = *myInput;
+   lastAmplitude = 0;
+   lastPeriod = 0;
+   lastRise = 0;
+   lastSwitch = pid->GetTime();
+   cycles = 0;
+   state = PID_TUNE_RUNNING;
+}
+
+/* Runtime() **********************************************************************
+ *     one look at the Input: follow the peak of the half cycle we are in, and
+ *   switch the relay once the Input is past the setpoint by the hysteresis.
+ *   every switch to the high output closes a cycle
+ **********************************************************************************/
+template<class Scalar>
+int BasicPIDAutoTune<Scalar>::Runtime()
+{
+   if (state != PID_TUNE_RUNNING) return state;
+   unsigned long now = pid->GetTime();
+   Scalar input = *myInput;
+   if (input > peakHigh) peakHigh = input;
+   if (input < peakLow) peakLow = input;
+
+   //with a DIRECT process the high output drives the Input up, so it is
+   //switched off once the Input is above the band, and back on below it
+   bool above = input > setpoint + hysteresis;
+   bool below = input < setpoint - hysteresis;
+   bool switchLow = high && (reverse ? below : above);
+   bool switchHigh = !high && (reverse ? above : below);
+
+   if (switchLow || switchHigh) lastSwitch = now;
+   else if (now - lastSwitch > timeout) { Finish(PID_TUNE_FAILED); return state; }
+
+   if (switchLow)
+   {
+      high = false;
+      *myOutput = outLow;
+   }
+   else if (switchHigh)
+   {
+      high = true;
+      *myOutput = outHigh;
+
+      if (lastRise != 0)
+      {
+         //a full cycle is done
+         unsigned long period = now - lastRise;
+         double a = double(peakHigh - peakLow) / 2;
+         double h = double(hysteresis);
+         if (a <= h) { Finish(PID_TUNE_FAILED); return state; }
+
+         if (cycles > 0 && lastPeriod > 0 &&
+             fabs(double(period) - double(lastPeriod)) < 0.05 * double(lastPeriod) &&
+             fabs(a - lastAmplitude) < 0.05 * lastAmplitude)
+         {
+            pu = period / 1000000.0;
+            ku = 2 * double(outHigh - outLow) / (M_PI * sqrt(a * a - h * h));
+            Finish(PID_TUNE_DONE);
+            return state;
+         }
+         lastPeriod = period;
+         lastAmplitude = a;
+         if (++cycles >= MaxCycles) { Finish(PID_TUNE_FAILED); return state; }
+      }
+      lastRise = now ? now : 1;         // 0 means no rise yet
+      peakHigh = peakLow = input;
+   }
+   return state;
+}
+
+template<class Scalar>
+void BasicPIDAutoTune<Scalar>::Cancel()
+{
+   if (state == PID_TUNE_RUNNING) Finish(PID_TUNE_IDLE);
+}
+
+/* Finish(...) ********************************************************************
+ *     puts the Output back to where it was at Start() and, on success, sets the
+ *   tunings from Ku and Pu:
+ *                 Kp        Ti        Td
+ *      ZN PID   0.6 Ku    Pu/2      Pu/8
+ *      ZN PI    0.45 Ku   Pu/1.2
+ *      TL PID   Ku/2.2    2.2 Pu    Pu/6.3
+ *      TL PI    Ku/3.2    2.2 Pu
+ *   then the PID returns to the mode it was in, starting bumpless from the
+ *   restored Output
+ **********************************************************************************/
+template<class Scalar>
+void BasicPIDAutoTune<Scalar>::Finish(int result)
+{
+   *myOutput = center;
+   state = result;
+   if (result == PID_TUNE_DONE)
+   {
+      double kp, ti, td = 0;
+      switch (rule)
+      {
+         case PID_TUNE_ZN_PI:  kp = 0.45 * ku;  ti = pu / 1.2; break;
+         case PID_TUNE_TL_PID: kp = ku / 2.2;   ti = 2.2 * pu; td = pu / 6.3; break;
+         case PID_TUNE_TL_PI:  kp = ku / 3.2;   ti = 2.2 * pu; break;
+         default:              kp = 0.6 * ku;   ti = pu / 2;   td = pu / 8; break;
+      }
+      pid->SetTunings(kp, kp / ti, kp * td);
+   }
+   if (wasAuto) pid->SetMode(AUTOMATIC);
+}
+
+#endif
@@ -0,0 +1,314 @@
+#ifndef PID_Bank_h
+#define PID_Bank_h
+
+#if ARDUINO >= 100
+  #include "Arduino.h"
+#else
+  #include "WProgram.h"
+#endif
+
+#include "PID_v1.h"
+
+/* PIDBank<N, Scalar> *************************************************************
+ *    N independent controllers that share one sample time and one clock read.
+ *  every per-channel value (tunings, limits, integrator, filter state) is kept
+ *  in its own contiguous array instead of in N separate PID objects, and all
+ *  channels are updated in a single branch-free pass over those arrays that
+ *  GCC vectorizes at -O3 (checked with plain SSE2 on x86-64, for float and
+ *  double).  with -Os, as in Arduino builds, it stays a plain loop.
+ *  channel i behaves exactly like a PID linked to Input[i], Output[i] and
+ *  Setpoint[i]; channels in MANUAL keep their Output and I sum.
+ *
+ *    double in[64], out[64], sp[64];
+ *    PIDBank<64> bank(in, out, sp);
+ *    bank.SetTunings(i, 2, 5, 1);  bank.SetMode(i, AUTOMATIC);
+ *    ...  bank.Compute();
+ **********************************************************************************/
+template<unsigned int N, class Scalar = double>
+class PIDBank
+{
+public:
+  PIDBank(Scalar*, Scalar*, Scalar*);   // * links the bank to arrays of N Inputs, Outputs and Setpoints
+
+  bool Compute();                       // * updates all channels in AUTOMATIC once SampleTime has
+                                        //   passed. returns true when the outputs were computed
+  void ComputeNow();                    // * updates all channels in AUTOMATIC right away, for
+                                        //   calling from a timer interrupt (see PID_Timer.h)
+
+  //Setters (per channel)
+  void SetMode(unsigned int, int);
+  void SetOutputLimits(unsigned int, double, double);
+  void SetIntegratorLimits(unsigned int, double, double);
+  void SetTunings(unsigned int, double, double, double);
+  void SetTunings(unsigned int, double, double, double, int);
+  void SetControllerDirection(unsigned int, int);
+  void SetSmoothingFactor(unsigned int, double);
+
+  //Setters (whole bank)
+  void SetSampleTime(int);
+  void SetSampleTimeUs(unsigned long);
+  void SetTimebase(int);
+  void SetTimeSource(unsigned long (*)());
+
+  //Getters
+  double GetKp(unsigned int ch) { return dispKp[ch]; }
+  double GetKi(unsigned int ch) { return dispKi[ch]; }
+  double GetKd(unsigned int ch) { return dispKd[ch]; }
+  int GetMode(unsigned int ch) { return inAuto[ch] ? AUTOMATIC : MANUAL; }
+  int GetDirection(unsigned int ch) { return direction[ch]; }
+  bool GetPonE(unsigned int ch) { return pOnE[ch]; }
+  Scalar GetLastIPart(unsigned int ch) { return integrator[ch]; }
+
+private:
+  void Initialize(unsigned int);
+  void ScaleTunings(unsigned int);
+  static unsigned long MillisAsMicros() { return millis() * 1000UL; }
+
+  Scalar *myInput;                      // * arrays of N values each, owned by the user
+  Scalar *myOutput;
+  Scalar *mySetpoint;
+
+  //structure of arrays, one entry per channel
+  Scalar kpError[N], kpInput[N];        // * scaled and signed Kp on error for P_ON_E, on input for
+                                        //   P_ON_M, and 0 for the other
+  Scalar ki[N], kd[N];
+  Scalar filterAlpha[N], filterBeta[N]; // * EWMA weights alpha and 1-alpha, 0 and 1 in P_ON_M
+  double smoothing[N];
+  Scalar integrator[N];
+  Scalar lastFilteredInput[N];
+  Scalar outMin[N], outMax[N];
+  Scalar integratorMin[N], integratorMax[N];  // * effective limits, = output limits in P_ON_M
+  double rawIntegratorMin[N], rawIntegratorMax[N];
+  double dispKp[N], dispKi[N], dispKd[N];
+  unsigned char pOnE[N], inAuto[N], direction[N];
+
+  unsigned long (*timeSource)();
+  unsigned long lastTime;
+  unsigned long SampleTime;             // in Microseconds
+};
+
+/*Constructor (...)*********************************************************
+ *    all channels start out in MANUAL, P_ON_E and DIRECT with zero tunings
+ *    and the same default limits and sample time as a single PID
+ ***************************************************************************/
+template<unsigned int N, class Scalar>
+PIDBank<N, Scalar>::PIDBank(Scalar *Input, Scalar *Output, Scalar *Setpoint)
+{
+   myInput = Input;
+   myOutput = Output;
+   mySetpoint = Setpoint;
+   SampleTime = 100000UL;
+   timeSource = MillisAsMicros;
+   for (unsigned int i = 0; i < N; i++)
+   {
+      inAuto[i] = false;
+      pOnE[i] = true;
+      direction[i] = DIRECT;
+      integrator[i] = 0;
+      lastFilteredInput[i] = 0;
+      dispKp[i] = dispKi[i] = dispKd[i] = 0;
+      SetSmoothingFactor(i, 0.9);
+      rawIntegratorMin[i] = -100;
+      rawIntegratorMax[i] = 100;
+      SetOutputLimits(i, 0, 255);
+      SetTunings(i, 0, 0, 0, P_ON_E);
+   }
+   lastTime = timeSource()-SampleTime;
+}
+
+/* Compute() **********************************************************************
+ *     one pass over all channels, same math as PID::Compute().  instead of
+ *   branching, every channel is computed and the output and I sum are only
+ *   stored for the ones in AUTOMATIC.  P_ON_E and P_ON_M differ in
+ *   coefficients only: Kp sits in kpError or in kpInput, and in P_ON_M the
+ *   filter weights are 0 and 1, so dInput is the unfiltered difference.  what
+ *   is left are selects of values and min/max clamps; an operation inside a
+ *   select would be a branch again (check with -O3 -fopt-info-vec).
+ **********************************************************************************/
+template<unsigned int N, class Scalar>
+bool PIDBank<N, Scalar>::Compute()
+{
+   unsigned long now = timeSource();
+   if (now - lastTime < SampleTime) return false;
+   ComputeNow();
+   lastTime = now;
+   return true;
+}
+
+template<unsigned int N, class Scalar>
+void PIDBank<N, Scalar>::ComputeNow()
+{
+   const Scalar margin = Scalar(0.01);
+   for (unsigned int i = 0; i < N; i++)
+   {
+      Scalar input = myInput[i];
+      Scalar error = mySetpoint[i] - input;
+      Scalar lastOutput = myOutput[i];
+
+      Scalar filtered = filterAlpha[i] * lastFilteredInput[i] + filterBeta[i] * input;
+      Scalar dInput = filtered - lastFilteredInput[i];
+
+      //don't let the I sum grow while the output is saturated (P_ON_E only)
+      bool hold = (pOnE[i] != 0) & ((lastOutput >= outMax[i] - margin) | (lastOutput <= outMin[i] + margin));
+      Scalar iSum = integrator[i] + ki[i] * (hold ? Scalar(0) : error) - kpInput[i] * dInput;
+
+      iSum = iSum > outMax[i] ? outMax[i] : iSum;
+      iSum = iSum < outMin[i] ? outMin[i] : iSum;
+      iSum = iSum > integratorMax[i] ? integratorMax[i] : iSum;
+      iSum = iSum < integratorMin[i] ? integratorMin[i] : iSum;
+
+      Scalar output = kpError[i] * error + iSum - kd[i] * dInput;
+      output = output > outMax[i] ? outMax[i] : output;
+      output = output < outMin[i] ? outMin[i] : output;
+
+      //the filter runs in MANUAL too, SetMode() restarts it anyway.  stored
+      //first, it keeps the compiler from turning the other two stores into
+      //conditional ones, which would stop the vectorizer
+      bool a = inAuto[i] != 0;
+      lastFilteredInput[i] = filtered;
+      integrator[i] = a ? iSum : integrator[i];
+      myOutput[i] = a ? output : lastOutput;
+   }
+}
+
+/* SetTunings(...)*************************************************************
+ * same as PID::SetTunings(), for channel ch
+ ******************************************************************************/
+template<unsigned int N, class Scalar>
+void PIDBank<N, Scalar>::SetTunings(unsigned int ch, double Kp, double Ki, double Kd, int POn)
+{
+   if (ch >= N || Kp<0 || Ki<0 || Kd<0) return;
+   pOnE[ch] = POn == P_ON_E;
+   dispKp[ch] = Kp; dispKi[ch] = Ki; dispKd[ch] = Kd;
+   ScaleTunings(ch);
+   SetIntegratorLimits(ch, rawIntegratorMin[ch], rawIntegratorMax[ch]);
+   if (Ki == 0) integrator[ch] = 0;
+}
+
+template<unsigned int N, class Scalar>
+void PIDBank<N, Scalar>::SetTunings(unsigned int ch, double Kp, double Ki, double Kd)
+{
+   if (ch < N) SetTunings(ch, Kp, Ki, Kd, pOnE[ch] ? P_ON_E : P_ON_M);
+}
+
+template<unsigned int N, class Scalar>
+void PIDBank<N, Scalar>::ScaleTunings(unsigned int ch)
+{
+   double SampleTimeInSec = ((double)SampleTime)/1000000;
+   double sign = direction[ch] == REVERSE ? -1 : 1;
+   kpError[ch] = pOnE[ch] ? sign * dispKp[ch] : 0;
+   kpInput[ch] = pOnE[ch] ? 0 : sign * dispKp[ch];
+   ki[ch] = sign * dispKi[ch] * SampleTimeInSec;
+   kd[ch] = sign * dispKd[ch] / SampleTimeInSec;
+   filterAlpha[ch] = pOnE[ch] ? smoothing[ch] : 0;
+   filterBeta[ch] = pOnE[ch] ? 1 - smoothing[ch] : 1;
+}
+
+template<unsigned int N, class Scalar>
+void PIDBank<N, Scalar>::SetControllerDirection(unsigned int ch, int Direction)
+{
+   if (ch >= N) return;
+   direction[ch] = Direction;
+   ScaleTunings(ch);
+}
+
+/* SetSampleTime(...) *********************************************************
+ * the sample time is shared by all channels, it rescales every channel's gains
+ ******************************************************************************/
+template<unsigned int N, class Scalar>
+void PIDBank<N, Scalar>::SetSampleTime(int NewSampleTime)
+{
+   if (NewSampleTime > 0) SetSampleTimeUs((unsigned long)NewSampleTime * 1000UL);
+}
+
+template<unsigned int N, class Scalar>
+void PIDBank<N, Scalar>::SetSampleTimeUs(unsigned long NewSampleTime)
+{
+   if (NewSampleTime == 0) return;
+   SampleTime = NewSampleTime;
+   for (unsigned int i = 0; i < N; i++) ScaleTunings(i);
+}
+
+template<unsigned int N, class Scalar>
+void PIDBank<N, Scalar>::SetTimebase(int Timebase)
+{
+   timeSource = Timebase == PID_MICROS ? micros : MillisAsMicros;
+   lastTime = timeSource()-SampleTime;
+}
+
+template<unsigned int N, class Scalar>
+void PIDBank<N, Scalar>::SetTimeSource(unsigned long (*Clock)())
+{
+   timeSource = Clock;
+   lastTime = timeSource()-SampleTime;
+}
+
+template<unsigned int N, class Scalar>
+void PIDBank<N, Scalar>::SetSmoothingFactor(unsigned int ch, double alpha)
+{
+   if (ch >= N) return;
+   smoothing[ch] = alpha;
+   ScaleTunings(ch);
+}
+
+/* SetOutputLimits(...) / SetIntegratorLimits(...) ****************************
+ * the bank stores the effective integrator limits: in P_ON_M the integrator
+ * also holds the P part, so there it is limited by the output limits only
+ ******************************************************************************/
+template<unsigned int N, class Scalar>
+void PIDBank<N, Scalar>::SetOutputLimits(unsigned int ch, double Min, double Max)
+{
+   if (ch >= N || Min >= Max) return;
+   outMin[ch] = Min;
+   outMax[ch] = Max;
+   SetIntegratorLimits(ch, rawIntegratorMin[ch], rawIntegratorMax[ch]);
+
+   if (inAuto[ch])
+   {
+      if (myOutput[ch] > outMax[ch]) myOutput[ch] = outMax[ch];
+      else if (myOutput[ch] < outMin[ch]) myOutput[ch] = outMin[ch];
+
+      if (integrator[ch] > outMax[ch]) integrator[ch] = outMax[ch];
+      else if (integrator[ch] < outMin[ch]) integrator[ch] = outMin[ch];
+   }
+}
+
+template<unsigned int N, class Scalar>
+void PIDBank<N, Scalar>::SetIntegratorLimits(unsigned int ch, double Min, double Max)
+{
+   if (ch >= N || Min >= Max) return;
+   rawIntegratorMin[ch] = Min;
+   rawIntegratorMax[ch] = Max;
+   integratorMin[ch] = pOnE[ch] ? Scalar(Min) : outMin[ch];
+   integratorMax[ch] = pOnE[ch] ? Scalar(Max) : outMax[ch];
+
+   if (inAuto[ch])
+   {
+      if (integrator[ch] > integratorMax[ch]) integrator[ch] = integratorMax[ch];
+      else if (integrator[ch] < integratorMin[ch]) integrator[ch] = integratorMin[ch];
+   }
+}
+
+/* SetMode(...)****************************************************************
+ * bumpless manual to automatic transfer, per channel
+ ******************************************************************************/
+template<unsigned int N, class Scalar>
+void PIDBank<N, Scalar>::SetMode(unsigned int ch, int Mode)
+{
+   if (ch >= N) return;
+   bool newAuto = (Mode == AUTOMATIC);
+   if (newAuto && !inAuto[ch]) Initialize(ch);
+   inAuto[ch] = newAuto;
+}
+
+template<unsigned int N, class Scalar>
+void PIDBank<N, Scalar>::Initialize(unsigned int ch)
+{
+   integrator[ch] = myOutput[ch];
+   lastFilteredInput[ch] = myInput[ch];
+
+   if (integrator[ch] > outMax[ch]) integrator[ch] = outMax[ch];
+   else if (integrator[ch] < outMin[ch]) integrator[ch] = outMin[ch];
+}
+
+#endif
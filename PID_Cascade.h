@@ -0,0 +1,156 @@
+#ifndef PID_Cascade_h
+#define PID_Cascade_h
+
+#if ARDUINO >= 100
+  #include "Arduino.h"
+#else
+  #include "WProgram.h"
+#endif
+
+#include "PID_v1.h"
+
+/**********************************************************************************
+ * BasicPIDCascade<Scalar>, PIDCascade
+ *
+ *    two PIDs in cascade: the outer loop (e.g. temperature or position) sets
+ *  the setpoint of the inner loop (e.g. heater power or speed), whose output
+ *  drives the process.  the cascade keeps the time for both: the inner loop is
+ *  computed every SampleTime, the outer one every Ratio inner samples, in the
+ *  same call and before the inner one, so the inner loop always works on the
+ *  newest setpoint.  the PIDs are only used through their value based
+ *  ComputeNow(), so they don't need linked variables:
+ *
+ *      PID outer(2, 0.5, 0, P_ON_E, DIRECT), inner(1, 5, 0, P_ON_E, DIRECT);
+ *      PIDCascade cascade(&outer, &inner, &Temperature, &Power, &Output, &Setpoint, 10);
+ *      outer.SetOutputLimits(0, 2000);      //the range of inner setpoints
+ *      cascade.SetSampleTime(10);           //inner at 100Hz, outer at 10Hz
+ *      cascade.SetMode(AUTOMATIC);
+ *      ...  cascade.Compute();
+ *
+ *  while the inner loop is saturated the outer integrator is held, so the
+ *  outer loop doesn't wind up asking for a setpoint the inner one can't reach.
+ *  tunings, limits and the like are still set on the two PIDs directly, except
+ *  for the sample times, which the cascade sets.
+ **********************************************************************************/
+template<class Scalar>
+class BasicPIDCascade
+{
+public:
+  BasicPIDCascade(BasicPID<Scalar>*, BasicPID<Scalar>*,  // * outer and inner PID, the outer loop's input,
+      Scalar*, Scalar*, Scalar*, Scalar*,               //   the inner loop's input, the output and the
+      unsigned int);                                    //   setpoint, and how many inner samples per outer one
+
+  bool Compute();                       // * computes once SampleTime has passed, true if it did
+  void ComputeNow();                    // * computes right away, for calling from a timer interrupt
+
+  void SetMode(int);                    // * both loops, bumpless: the outer one starts from the
+                                        //   inner input as its output (the inner setpoint)
+  void SetSampleTime(int);              // * the inner loop's sample time, in Milliseconds
+  void SetSampleTimeUs(unsigned long);  // * same, in Microseconds
+  void SetTimebase(int);
+  void SetTimeSource(unsigned long (*)());
+
+  Scalar GetInnerSetpoint() { return innerSetpoint; }
+
+private:
+  static unsigned long MillisAsMicros() { return millis() * 1000UL; }
+
+  BasicPID<Scalar> *outer;
+  BasicPID<Scalar> *inner;
+  Scalar *outerInput;
+  Scalar *innerInput;
+  Scalar *myOutput;
+  Scalar *mySetpoint;
+  Scalar innerSetpoint;
+  unsigned long (*timeSource)();
+  unsigned long lastTime;
+  unsigned long SampleTime;             // of the inner loop, in Microseconds
+  unsigned int ratio;
+  unsigned int count;                   // inner samples since the last outer one
+};
+
+typedef BasicPIDCascade<double> PIDCascade;
+
+template<class Scalar>
+BasicPIDCascade<Scalar>::BasicPIDCascade(BasicPID<Scalar> *Outer, BasicPID<Scalar> *Inner,
+        Scalar *OuterInput, Scalar *InnerInput, Scalar *Output, Scalar *Setpoint, unsigned int Ratio)
+{
+   outer = Outer;
+   inner = Inner;
+   outerInput = OuterInput;
+   innerInput = InnerInput;
+   myOutput = Output;
+   mySetpoint = Setpoint;
+   innerSetpoint = *InnerInput;
+   ratio = Ratio > 0 ? Ratio : 1;
+   count = ratio - 1;
+   timeSource = MillisAsMicros;
+   SetSampleTimeUs(inner->GetSampleTimeUs());
+}
+
+template<class Scalar>
+bool BasicPIDCascade<Scalar>::Compute()
+{
+   unsigned long now = timeSource();
+   if (now - lastTime < SampleTime) return false;
+   ComputeNow();
+   lastTime = now;
+   return true;
+}
+
+/* ComputeNow() *******************************************************************
+ *     every Ratio-th call the outer loop runs first, held if the inner loop
+ *   ended its last sample saturated, then the inner loop runs on the new setpoint
+ **********************************************************************************/
+template<class Scalar>
+void BasicPIDCascade<Scalar>::ComputeNow()
+{
+   if (++count >= ratio)
+   {
+      count = 0;
+      outer->SetIntegratorHold(inner->GetMode() == AUTOMATIC && inner->IsSaturated());
+      innerSetpoint = outer->ComputeNow(*outerInput, *mySetpoint);
+   }
+   *myOutput = inner->ComputeNow(*innerInput, innerSetpoint);
+}
+
+template<class Scalar>
+void BasicPIDCascade<Scalar>::SetMode(int Mode)
+{
+   if (Mode == AUTOMATIC && outer->GetMode() != AUTOMATIC) innerSetpoint = *innerInput;
+   inner->SetMode(Mode, *innerInput, *myOutput);
+   outer->SetMode(Mode, *outerInput, innerSetpoint);
+   count = ratio - 1;                   // start with an outer sample
+}
+
+template<class Scalar>
+void BasicPIDCascade<Scalar>::SetSampleTime(int NewSampleTime)
+{
+   if (NewSampleTime > 0) SetSampleTimeUs((unsigned long)NewSampleTime * 1000UL);
+}
+
+template<class Scalar>
+void BasicPIDCascade<Scalar>::SetSampleTimeUs(unsigned long NewSampleTime)
+{
+   if (NewSampleTime == 0) return;
+   SampleTime = NewSampleTime;
+   inner->SetSampleTimeUs(SampleTime);
+   outer->SetSampleTimeUs(SampleTime * ratio);
+   lastTime = timeSource()-SampleTime;
+}
+
+template<class Scalar>
+void BasicPIDCascade<Scalar>::SetTimebase(int Timebase)
+{
+   timeSource = Timebase == PID_MICROS ? micros : MillisAsMicros;
+   lastTime = timeSource()-SampleTime;
+}
+
+template<class Scalar>
+void BasicPIDCascade<Scalar>::SetTimeSource(unsigned long (*Clock)())
+{
+   timeSource = Clock;
+   lastTime = timeSource()-SampleTime;
+}
+
+#endif
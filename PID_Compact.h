@@ -0,0 +1,250 @@
+#ifndef PID_Compact_h
+#define PID_Compact_h
+
+#if ARDUINO >= 100
+  #include "Arduino.h"
+#else
+  #include "WProgram.h"
+#endif
+
+#include <stdint.h>
+#include "PID_v1.h"
+
+/**********************************************************************************
+ * PIDCompact<Smoothing>
+ *
+ *    a PID for chips with very little RAM.  it is used like PID (same
+ *  constructor, Compute(), SetMode(), SetTunings() ...), but stores only what
+ *  the calculation needs, as float:
+ *
+ *                                      AVR bytes
+ *    Input, Output, Setpoint pointers      6
+ *    kp, ki, kd (scaled, signed)          12
+ *    integrator, last input                8
+ *    output limits                         8
+ *    last time, sample time (16 bit ms)    4
+ *    mode, direction, P_ON_E flags         1
+ *                                         --
+ *                                         39
+ *
+ *  the differences to PID, all to save RAM:
+ *   - the input filter factor is a template parameter, alpha = Smoothing/256
+ *     (0, the default, means no filtering).  PIDCompact<230> ~ SetSmoothingFactor(0.9)
+ *   - there are no separate integrator limits, the I sum is kept within the
+ *     output limits
+ *   - GetKp/Ki/Kd() are derived from the working gains instead of stored
+ *   - the sample time is in whole Milliseconds, at most 65535, and Compute()
+ *     has to be called at least once every 65 seconds
+ *   - no diagnostic getters, telemetry or Microsecond timebase
+ **********************************************************************************/
+
+template<uint8_t Smoothing = 0>
+class PIDCompact
+{
+public:
+  PIDCompact(float*, float*, float*, float, float, float, int, int);
+  PIDCompact(float*, float*, float*, float, float, float, int);
+
+  bool Compute();
+
+  void SetMode(int Mode);
+  void SetOutputLimits(float, float);
+  void SetTunings(float, float, float);
+  void SetTunings(float, float, float, int);
+  void SetControllerDirection(int);
+  void SetSampleTime(int);              // * in Milliseconds, 1 to 65535
+
+  float GetKp();
+  float GetKi();
+  float GetKd();
+  int GetMode() { return flags & FlagAuto ? AUTOMATIC : MANUAL; }
+  int GetDirection() { return flags & FlagReverse ? REVERSE : DIRECT; }
+  bool GetPonE() { return flags & FlagPonE; }
+  float GetLastIPart() { return integrator; }
+
+private:
+  enum { FlagAuto = 1, FlagPonE = 2, FlagReverse = 4 };
+  void Initialize();
+  float SampleTimeInSec() { return SampleTime * 0.001f; }
+
+  float *myInput;
+  float *myOutput;
+  float *mySetpoint;
+  float kp, ki, kd;
+  float integrator;
+  float lastInput;                      // filtered in P_ON_E, raw in P_ON_M
+  float outMin, outMax;
+  uint16_t lastTime;
+  uint16_t SampleTime;                  // in Milliseconds
+  uint8_t flags;
+};
+
+template<uint8_t Smoothing>
+PIDCompact<Smoothing>::PIDCompact(float *Input, float *Output, float *Setpoint,
+                                  float Kp, float Ki, float Kd, int POn, int ControllerDirection)
+{
+   myInput = Input;
+   myOutput = Output;
+   mySetpoint = Setpoint;
+   flags = ControllerDirection == REVERSE ? FlagReverse : 0;
+   integrator = 0;
+   outMin = 0;
+   outMax = 255;
+   SampleTime = 100;
+   kp = ki = kd = 0;
+   SetTunings(Kp, Ki, Kd, POn);
+   lastTime = (uint16_t)millis() - SampleTime;
+}
+
+template<uint8_t Smoothing>
+PIDCompact<Smoothing>::PIDCompact(float *Input, float *Output, float *Setpoint,
+                                  float Kp, float Ki, float Kd, int ControllerDirection)
+    : PIDCompact(Input, Output, Setpoint, Kp, Ki, Kd, P_ON_E, ControllerDirection)
+{
+}
+
+/* Compute() **********************************************************************
+ *     same calculation as PID::Compute()
+ **********************************************************************************/
+template<uint8_t Smoothing>
+bool PIDCompact<Smoothing>::Compute()
+{
+   if (!(flags & FlagAuto)) return false;
+   uint16_t now = (uint16_t)millis();
+   if ((uint16_t)(now - lastTime) < SampleTime) return false;
+
+   float input = *myInput;
+   float error = *mySetpoint - input;
+   float dInput;
+   float output;
+
+   if (flags & FlagPonE)
+   {
+      float lastOutput = *myOutput;
+      if (lastOutput < outMax - 0.01f && lastOutput > outMin + 0.01f) integrator += ki * error;
+
+      float filtered = Smoothing ? (Smoothing * lastInput + (256 - Smoothing) * input) * (1.0f / 256) : input;
+      dInput = filtered - lastInput;
+      lastInput = filtered;
+      output = kp * error;
+   }
+   else
+   {
+      integrator += ki * error;
+      dInput = input - lastInput;
+      lastInput = input;
+      integrator -= kp * dInput;
+      output = 0;
+   }
+
+   if (integrator > outMax) integrator = outMax;
+   else if (integrator < outMin) integrator = outMin;
+
+   output += integrator - kd * dInput;
+   if (output > outMax) output = outMax;
+   else if (output < outMin) output = outMin;
+   *myOutput = output;
+
+   lastTime = now;
+   return true;
+}
+
+template<uint8_t Smoothing>
+void PIDCompact<Smoothing>::SetTunings(float Kp, float Ki, float Kd, int POn)
+{
+   if (Kp<0 || Ki<0 || Kd<0) return;
+
+   if (POn == P_ON_E) flags |= FlagPonE;
+   else flags &= ~FlagPonE;
+
+   float sign = flags & FlagReverse ? -1 : 1;
+   kp = sign * Kp;
+   ki = sign * Ki * SampleTimeInSec();
+   kd = sign * Kd / SampleTimeInSec();
+
+   if (Ki == 0) integrator = 0;
+}
+
+template<uint8_t Smoothing>
+void PIDCompact<Smoothing>::SetTunings(float Kp, float Ki, float Kd)
+{
+   SetTunings(Kp, Ki, Kd, flags & FlagPonE ? P_ON_E : P_ON_M);
+}
+
+/* GetKp() etc.  ******************************************************************
+ * the user-entered tunings aren't kept, they are calculated back from the
+ * working gains (so they may differ from what was set in the last digits)
+ **********************************************************************************/
+template<uint8_t Smoothing>
+float PIDCompact<Smoothing>::GetKp() { return kp < 0 ? -kp : kp; }
+
+template<uint8_t Smoothing>
+float PIDCompact<Smoothing>::GetKi() { return (ki < 0 ? -ki : ki) / SampleTimeInSec(); }
+
+template<uint8_t Smoothing>
+float PIDCompact<Smoothing>::GetKd() { return (kd < 0 ? -kd : kd) * SampleTimeInSec(); }
+
+template<uint8_t Smoothing>
+void PIDCompact<Smoothing>::SetSampleTime(int NewSampleTime)
+{
+   //SampleTime is 16 bit, larger values (possible with a 32 bit int) are ignored
+   if (NewSampleTime > 0 && (unsigned long)NewSampleTime <= 0xFFFFUL)
+   {
+      float ratio = (float)NewSampleTime / SampleTime;
+      ki *= ratio;
+      kd /= ratio;
+      SampleTime = (uint16_t)NewSampleTime;
+   }
+}
+
+template<uint8_t Smoothing>
+void PIDCompact<Smoothing>::SetOutputLimits(float Min, float Max)
+{
+   if (Min >= Max) return;
+   outMin = Min;
+   outMax = Max;
+
+   if (flags & FlagAuto)
+   {
+      if (*myOutput > outMax) *myOutput = outMax;
+      else if (*myOutput < outMin) *myOutput = outMin;
+
+      if (integrator > outMax) integrator = outMax;
+      else if (integrator < outMin) integrator = outMin;
+   }
+}
+
+template<uint8_t Smoothing>
+void PIDCompact<Smoothing>::SetControllerDirection(int Direction)
+{
+   bool reverse = Direction == REVERSE;
+   if (reverse != (bool)(flags & FlagReverse))
+   {
+      kp = -kp;
+      ki = -ki;
+      kd = -kd;
+   }
+   if (reverse) flags |= FlagReverse;
+   else flags &= ~FlagReverse;
+}
+
+template<uint8_t Smoothing>
+void PIDCompact<Smoothing>::SetMode(int Mode)
+{
+   bool newAuto = (Mode == AUTOMATIC);
+   if (newAuto && !(flags & FlagAuto)) Initialize();
+   if (newAuto) flags |= FlagAuto;
+   else flags &= ~FlagAuto;
+}
+
+template<uint8_t Smoothing>
+void PIDCompact<Smoothing>::Initialize()
+{
+   integrator = *myOutput;
+   lastInput = *myInput;
+
+   if (integrator > outMax) integrator = outMax;
+   else if (integrator < outMin) integrator = outMin;
+}
+
+#endif
@@ -0,0 +1,25 @@
+#ifndef PID_Crc_h
+#define PID_Crc_h
+
+#include <stdint.h>
+#include <stddef.h>
+
+/* PIDCrc16(...) *******************************************************************
+ * CRC-16/CCITT-FALSE (polynomial 0x1021, start value 0xFFFF), bitwise so it
+ * needs no table in flash. shared by the telemetry frames and the saved states
+ **********************************************************************************/
+inline uint16_t PIDCrc16(uint16_t crc, uint8_t b)
+{
+   crc ^= (uint16_t)b << 8;
+   for (uint8_t i = 0; i < 8; i++)
+      crc = crc & 0x8000 ? (crc << 1) ^ 0x1021 : crc << 1;
+   return crc;
+}
+
+inline uint16_t PIDCrc16(const uint8_t *data, size_t n, uint16_t crc = 0xFFFF)
+{
+   while (n--) crc = PIDCrc16(crc, *data++);
+   return crc;
+}
+
+#endif
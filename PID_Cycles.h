@@ -0,0 +1,107 @@
+#ifndef PID_Cycles_h
+#define PID_Cycles_h
+
+#if ARDUINO >= 100
+  #include "Arduino.h"
+#else
+  #include "WProgram.h"
+#endif
+
+/**********************************************************************************
+ * Execution time instrumentation, only compiled in with PID_CYCLE_COUNTER
+ *
+ *    Compute() keeps min, max and mean execution time of the calls that computed
+ *  a new output and of the ones that didn't (not due yet, or in MANUAL).
+ *  the times are in CPU cycles, taken from
+ *
+ *    Cortex-M3/M4/M7/M33   the DWT cycle counter, exact
+ *    ESP32 (Xtensa)        the CCOUNT register, exact
+ *    x86 (host builds)     the time stamp counter
+ *    AVR                   Timer1, switched to count CPU cycles (no prescaler).  exact up
+ *                          to 65535 cycles per call (4ms at 16MHz).  this takes Timer1
+ *                          away from everything else that uses it: PIDTimer1Begin() and
+ *                          PID_TIMER1_ISR (PID_Timer.h refuses to build with it),
+ *                          analogWrite() on its pins (9 and 10 on an Uno) and libraries
+ *                          like Servo, which in turn leave the counts meaningless.
+ *                          define PID_CYCLE_COUNTER_MICROS to use micros() instead
+ *    everything else       micros() times clock cycles per Microsecond, so only
+ *                          to within one micros() tick (4us = 64 cycles on a 16MHz AVR)
+ *                          (in Microseconds if F_CPU isn't known)
+ **********************************************************************************/
+
+struct PIDCycleStats
+{
+  uint32_t Min, Max;
+  uint32_t Count;
+  uint64_t Total;
+
+  PIDCycleStats() { Reset(); }
+  void Reset() { Min = 0xFFFFFFFFUL; Max = 0; Count = 0; Total = 0; }
+  void Add(uint32_t cycles)
+  {
+     if (cycles < Min) Min = cycles;
+     if (cycles > Max) Max = cycles;
+     Count++;
+     Total += cycles;
+  }
+  uint32_t Mean() const { return Count ? (uint32_t)(Total / Count) : 0; }
+};
+
+#if defined(__ARM_ARCH_7M__) || defined(__ARM_ARCH_7EM__) || defined(__ARM_ARCH_8M_MAIN__)
+inline void PIDCycleCounterBegin()
+{
+   volatile uint32_t *DEMCR = (volatile uint32_t *)0xE000EDFC;
+   volatile uint32_t *DWT_CTRL = (volatile uint32_t *)0xE0001000;
+   *DEMCR |= 1UL << 24;                 // TRCENA
+   *DWT_CTRL |= 1UL;                    // CYCCNTENA
+}
+inline uint32_t PIDCycleCount() { return *(volatile uint32_t *)0xE0001004; }   // DWT_CYCCNT
+
+#elif defined(__XTENSA__)
+inline void PIDCycleCounterBegin() {}
+inline uint32_t PIDCycleCount()
+{
+   uint32_t ccount;
+   asm volatile("rsr %0, ccount" : "=a"(ccount));
+   return ccount;
+}
+
+#elif defined(__x86_64__) || defined(__i386__)
+inline void PIDCycleCounterBegin() {}
+inline uint32_t PIDCycleCount() { return (uint32_t)__builtin_ia32_rdtsc(); }
+
+#elif defined(__AVR__) && !defined(PID_CYCLE_COUNTER_MICROS)
+inline void PIDCycleCounterBegin() {}
+inline uint32_t PIDCycleCount()
+{
+   //set up once, on first use: a global PID is constructed before init()
+   //configures Timer1 for PWM.  high counts the wrap arounds seen between two
+   //reads, so the difference of a start and an end read is right up to 65535
+   //cycles
+   static uint16_t high = 0, last = 0;
+   static bool started = false;
+   if (!started)
+   {
+      TCCR1A = 0;
+      TCCR1B = _BV(CS10);
+      started = true;
+   }
+   uint16_t t = TCNT1;
+   if (t < last) high++;
+   last = t;
+   return ((uint32_t)high << 16) | t;
+}
+
+#else
+inline void PIDCycleCounterBegin() {}
+inline uint32_t PIDCycleCount()
+{
+#if defined(F_CPU)
+   return (uint32_t)micros() * (uint32_t)(F_CPU / 1000000UL);
+#else
+   return (uint32_t)micros();
+#endif
+}
+#endif
+
+#endif
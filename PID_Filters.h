@@ -0,0 +1,215 @@
+#ifndef PID_Filters_h
+#define PID_Filters_h
+
+#include <stdint.h>
+#include <math.h>
+
+/**********************************************************************************
+ * Input filters
+ *
+ *    by default the PID smooths its input with the single pole filter set by
+ *  SetSmoothingFactor().  a PIDInputFilter set with SetInputFilter() replaces it,
+ *  for when more noise rejection is needed than a single pole gives without too
+ *  much phase lag:
+ *
+ *      PIDBiquad<double> lowPass;
+ *      lowPass.SetLowPass(5, 100);          //2nd order Butterworth, 5Hz at 100 samples/s
+ *      myPID.SetInputFilter(&lowPass);
+ *
+ *    PIDBiquad<Scalar>        2nd order IIR section, e.g. a Butterworth low pass
+ *    PIDMedian<N, Scalar>     moving median of the last N samples, removes spikes
+ *
+ *  like the built-in filter, the result is what the derivative is taken of in
+ *  P_ON_E.  the filters work sample by sample on fixed-size state, nothing is
+ *  allocated.  the biquad is meant for float/double: with the fixed-point types
+ *  its coefficients lose too much resolution for low cutoff frequencies.
+ *
+ *    PIDCicDecimator<R, Stages, Scalar> is not an input filter but sits in front
+ *  of the PID: it takes raw ADC readings at R times the sample rate (e.g. from
+ *  the ADC interrupt) and produces one clean, averaged value every R readings.
+ **********************************************************************************/
+
+template<class Scalar>
+class PIDInputFilter
+{
+public:
+  virtual Scalar Filter(Scalar) = 0;    // * takes the next input sample, returns the filtered value
+  virtual void Reset(Scalar) = 0;       // * settles the filter as if the input had been at this
+                                        //   value for a long time (bumpless start)
+};
+
+/* PIDBiquad<Scalar> **************************************************************
+ *     y = (b0 + b1 z^-1 + b2 z^-2) / (1 + a1 z^-1 + a2 z^-2) x, computed in the
+ *   transposed direct form II (two state values).  starts out as a pass-through.
+ **********************************************************************************/
+template<class Scalar>
+class PIDBiquad : public PIDInputFilter<Scalar>
+{
+public:
+  PIDBiquad() : b0(1), b1(0), b2(0), a1(0), a2(0), s1(0), s2(0) {}
+
+  void SetCoefficients(double B0, double B1, double B2, double A1, double A2);
+  void SetLowPass(double CutoffHz, double SampleHz,    // * Q = 0.7071 gives a Butterworth response
+                  double Q = 0.70710678);
+
+  Scalar Filter(Scalar x)
+  {
+     Scalar y = b0 * x + s1;
+     s1 = b1 * x - a1 * y + s2;
+     s2 = b2 * x - a2 * y;
+     return y;
+  }
+  void Reset(Scalar x);
+
+private:
+  Scalar b0, b1, b2, a1, a2;
+  Scalar s1, s2;
+};
+
+template<class Scalar>
+void PIDBiquad<Scalar>::SetCoefficients(double B0, double B1, double B2, double A1, double A2)
+{
+   b0 = B0; b1 = B1; b2 = B2; a1 = A1; a2 = A2;
+}
+
+/* SetLowPass(...) ****************************************************************
+ *     the usual bilinear transform low pass, with unity gain at DC.  the cutoff
+ *   has to stay below half the sample rate
+ **********************************************************************************/
+template<class Scalar>
+void PIDBiquad<Scalar>::SetLowPass(double CutoffHz, double SampleHz, double Q)
+{
+   if (CutoffHz <= 0 || SampleHz <= 2 * CutoffHz || Q <= 0) return;
+   double w = 2 * M_PI * CutoffHz / SampleHz;
+   double alpha = sin(w) / (2 * Q);
+   double c = cos(w);
+   double a0 = 1 + alpha;
+   SetCoefficients((1 - c) / 2 / a0, (1 - c) / a0, (1 - c) / 2 / a0, -2 * c / a0, (1 - alpha) / a0);
+}
+
+/* Reset(...) *********************************************************************
+ *     the steady state for a constant input x, assuming the filter passes DC
+ *   unchanged (as any low pass from SetLowPass() does)
+ **********************************************************************************/
+template<class Scalar>
+void PIDBiquad<Scalar>::Reset(Scalar x)
+{
+   s2 = b2 * x - a2 * x;
+   s1 = b1 * x - a1 * x + s2;
+}
+
+/* PIDMedian<N, Scalar> ***********************************************************
+ *     the median of the last N (odd) samples.  the samples are kept both in the
+ *   order they came in and sorted, so each new one only moves the others along
+ *   by one place: O(N) per sample, no sorting
+ **********************************************************************************/
+template<unsigned int N, class Scalar>
+class PIDMedian : public PIDInputFilter<Scalar>
+{
+  static_assert(N % 2 == 1, "PIDMedian needs an odd number of samples");
+  static_assert(N < 256, "PIDMedian keeps at most 255 samples");
+
+public:
+  PIDMedian() { Reset(Scalar(0)); }
+
+  Scalar Filter(Scalar);
+  void Reset(Scalar);
+
+private:
+  Scalar history[N];                    // in arrival order, oldest at index next
+  Scalar sorted[N];
+  uint8_t next;
+};
+
+template<unsigned int N, class Scalar>
+Scalar PIDMedian<N, Scalar>::Filter(Scalar x)
+{
+   Scalar oldest = history[next];
+   history[next] = x;
+   if (++next == N) next = 0;
+
+   //take the oldest sample out of the sorted list, closing the gap, then
+   //open a gap for the new one
+   unsigned int i = 0;
+   while (i + 1 < N && sorted[i] != oldest) i++;
+   for (; i + 1 < N && sorted[i + 1] < x; i++) sorted[i] = sorted[i + 1];
+   for (; i > 0 && sorted[i - 1] > x; i--) sorted[i] = sorted[i - 1];
+   sorted[i] = x;
+
+   return sorted[N / 2];
+}
+
+template<unsigned int N, class Scalar>
+void PIDMedian<N, Scalar>::Reset(Scalar x)
+{
+   for (unsigned int i = 0; i < N; i++) history[i] = sorted[i] = x;
+   next = 0;
+}
+
+/* PIDCicDecimator<R, Stages, Scalar> *********************************************
+ *     a cascaded integrator-comb filter: Stages integrators running at the ADC
+ *   rate, Stages combs running at 1/R of it.  it is a moving average of R
+ *   readings applied Stages times, done with additions only.  Add() returns true
+ *   every Rth reading, when Value() has a new result.  the registers are 32 bit
+ *   and wrap around harmlessly, as long as the input bits + Stages*log2(R) fit
+ *   in them (10 bit ADC, R = 16, 3 stages: 22 bits).
+ *
+ *      PIDCicDecimator<16> cic;             //oversample 16x
+ *      ISR(ADC_vect) { if (cic.Add(ADC)) Input = cic.Value(); }
+ **********************************************************************************/
+template<unsigned int R, unsigned int Stages = 3, class Scalar = float>
+class PIDCicDecimator
+{
+  static_assert(R > 1 && R < 65536, "PIDCicDecimator: R must be between 2 and 65535");
+  static_assert(Stages > 0 && Stages <= 5, "PIDCicDecimator: 1 to 5 stages");
+
+public:
+  PIDCicDecimator() { Reset(0); }
+
+  bool Add(int32_t);                    // * takes one ADC reading, true when a new value is ready
+  Scalar Value() { return Scalar(double(int32_t(output)) * InvGain()); } // * in ADC units
+  int32_t Raw() { return int32_t(output); }  // * the unscaled result, R^Stages times the ADC units
+  void Reset(int32_t);                  // * settles the filter on this ADC reading
+
+private:
+  static constexpr double Gain(unsigned int n) { return n ? R * Gain(n - 1) : 1; }
+  static constexpr double InvGain() { return 1 / Gain(Stages); }
+
+  //unsigned, so that the wrap around is well defined
+  uint32_t integrator[Stages];
+  uint32_t comb[Stages];                // previous input of each comb stage
+  uint32_t output;
+  uint16_t count;
+};
+
+template<unsigned int R, unsigned int Stages, class Scalar>
+bool PIDCicDecimator<R, Stages, Scalar>::Add(int32_t x)
+{
+   uint32_t v = uint32_t(x);
+   for (unsigned int i = 0; i < Stages; i++) v = integrator[i] += v;
+   if (++count < R) return false;
+   count = 0;
+
+   for (unsigned int i = 0; i < Stages; i++)
+   {
+      uint32_t in = v;
+      v -= comb[i];
+      comb[i] = in;
+   }
+   output = v;
+   return true;
+}
+
+/* Reset(...) *********************************************************************
+ *     starts from zero and runs Stages*R readings of x through the filter, which
+ *   is exactly as long as its response takes to settle
+ **********************************************************************************/
+template<unsigned int R, unsigned int Stages, class Scalar>
+void PIDCicDecimator<R, Stages, Scalar>::Reset(int32_t x)
+{
+   for (unsigned int i = 0; i < Stages; i++) integrator[i] = comb[i] = 0;
+   count = 0;
+   for (unsigned long n = 0; n < (unsigned long)Stages * R; n++) Add(x);
+}
+
+#endif
@@ -0,0 +1,89 @@
+#ifndef PID_Fixed_h
+#define PID_Fixed_h
+
+#include <stdint.h>
+
+/* PIDFixed<FracBits> *********************************************************
+ *    Signed 32 bit fixed-point number with FracBits fractional bits.  it is
+ *  meant to be used as the Scalar type of BasicPID on targets without an FPU
+ *  (on AVR, double is a 32 bit software float and every multiply costs a
+ *  library call.)  two formats are provided as typedefs below:
+ *
+ *    PIDQ16_16  range +-32768, resolution ~1.5e-5  (fits the 0-255 PWM range)
+ *    PIDQ8_24   range +-128,   resolution ~6e-8    (for normalized signals)
+ *
+ *  all arithmetic and the conversions saturate to the representable range
+ *  instead of wrapping, through a 64 bit intermediate: a P part pinned at the
+ *  limit plus the integrator has to stay at the limit, not flip to the other
+ *  rail.
+ ******************************************************************************/
+template<uint8_t FracBits>
+class PIDFixed
+{
+public:
+  static const int32_t One = (int32_t)1 << FracBits;
+  static const int32_t RawMax = 0x7FFFFFFFL;  //INT32_MAX is not available in C++ on every avr-libc
+  static const int32_t RawMin = -RawMax - 1;
+
+  constexpr PIDFixed() : raw(0) {}
+  constexpr PIDFixed(int v) : raw(Saturate((int64_t)v * One)) {}
+  constexpr PIDFixed(long v) : raw(Saturate((int64_t)v * One)) {}
+  constexpr PIDFixed(unsigned int v) : raw(Saturate((int64_t)v * One)) {}
+  constexpr PIDFixed(unsigned long v) : raw(v > (unsigned long)(RawMax >> FracBits) ? RawMax : (int32_t)v * One) {}
+  constexpr PIDFixed(double v) : raw(FromDouble(v)) {}
+
+  static PIDFixed FromRaw(int32_t r) { PIDFixed f; f.raw = r; return f; }
+  int32_t Raw() const { return raw; }
+
+  double ToDouble() const { return (double)raw / One; }
+  float ToFloat() const { return (float)raw / One; }
+  explicit operator double() const { return ToDouble(); }
+  explicit operator float() const { return ToFloat(); }
+  explicit operator long() const { return raw >> FracBits; }
+  explicit operator int() const { return (int)(raw >> FracBits); }
+
+  PIDFixed operator-() const { return FromRaw(Saturate(-(int64_t)raw)); }
+  PIDFixed& operator+=(PIDFixed b) { *this = *this + b; return *this; }
+  PIDFixed& operator-=(PIDFixed b) { *this = *this - b; return *this; }
+  PIDFixed& operator*=(PIDFixed b) { *this = *this * b; return *this; }
+  PIDFixed& operator/=(PIDFixed b) { *this = *this / b; return *this; }
+
+  friend PIDFixed operator+(PIDFixed a, PIDFixed b) { return FromRaw(Saturate((int64_t)a.raw + b.raw)); }
+  friend PIDFixed operator-(PIDFixed a, PIDFixed b) { return FromRaw(Saturate((int64_t)a.raw - b.raw)); }
+  friend PIDFixed operator*(PIDFixed a, PIDFixed b)
+  {
+     //32x32->64 widening multiply (a single __mulsidi3 call on avr-gcc)
+     return FromRaw(Saturate(((int64_t)a.raw * b.raw) >> FracBits));
+  }
+  friend PIDFixed operator/(PIDFixed a, PIDFixed b)
+  {
+     if (b.raw == 0) return FromRaw(a.raw >= 0 ? RawMax : RawMin);
+     return FromRaw(Saturate(((int64_t)a.raw * One) / b.raw));
+  }
+
+  friend bool operator==(PIDFixed a, PIDFixed b) { return a.raw == b.raw; }
+  friend bool operator!=(PIDFixed a, PIDFixed b) { return a.raw != b.raw; }
+  friend bool operator<(PIDFixed a, PIDFixed b) { return a.raw < b.raw; }
+  friend bool operator>(PIDFixed a, PIDFixed b) { return a.raw > b.raw; }
+  friend bool operator<=(PIDFixed a, PIDFixed b) { return a.raw <= b.raw; }
+  friend bool operator>=(PIDFixed a, PIDFixed b) { return a.raw >= b.raw; }
+
+private:
+  static constexpr int32_t FromDouble(double v)
+  {
+     return v * One >= 2147483647.0 ? RawMax :
+            v * One <= -2147483648.0 ? RawMin :
+            (int32_t)(v * One + (v >= 0 ? 0.5 : -0.5));
+  }
+  static constexpr int32_t Saturate(int64_t v)
+  {
+     return v > RawMax ? RawMax : v < RawMin ? RawMin : (int32_t)v;
+  }
+
+  int32_t raw;
+};
+
+typedef PIDFixed<16> PIDQ16_16;
+typedef PIDFixed<24> PIDQ8_24;
+
+#endif
@@ -0,0 +1,174 @@
+#ifndef PID_Relay_h
+#define PID_Relay_h
+
+#if ARDUINO >= 100
+  #include "Arduino.h"
+#else
+  #include "WProgram.h"
+#endif
+
+#include <stdint.h>
+
+#define PID_RELAY_NO_PIN 255            // a channel that is only switched in GetState()
+
+/**********************************************************************************
+ * PIDTimeProportioning<N, Scalar>
+ *
+ *    time proportioning ("slow PWM") for up to N relays or SSRs.  every Window
+ *  milliseconds each relay is switched on for the part of the window its
+ *  Output asks for, Output/FullScale, and off for the rest.  the driver reads
+ *  an array of Outputs, so it goes together with a PIDBank, or with separate
+ *  PIDs whose Outputs are in one array:
+ *
+ *      double Input[4], Output[4], Setpoint[4];
+ *      const uint8_t relayPins[4] = { 6, 7, 8, 9 };
+ *      PIDBank<4> bank(Input, Output, Setpoint);     //Output limits 0..100
+ *      PIDTimeProportioning<4> relays(Output, relayPins, 5000, 100);
+ *      relays.Begin();                               //in setup()
+ *      ...  bank.Compute();  relays.Update();        //every loop()
+ *
+ *  Update() doesn't block: it reads millis() once and only calls digitalWrite()
+ *  for the relays that change state.  the on time is worked out again on every
+ *  call, so a new Output takes effect within the running window.
+ *  with SetStagger() the windows of the channels are spread over the window
+ *  instead of all starting together, so the relays don't all switch on at once.
+ *  SetMinPulse() drops on or off pulses shorter than a minimum, which spares
+ *  mechanical relays the short clicks near 0 and 100%.
+ **********************************************************************************/
+template<unsigned int N, class Scalar = double>
+class PIDTimeProportioning
+{
+  static_assert(N > 0 && N < 256, "PIDTimeProportioning drives 1 to 255 relays");
+
+public:
+  PIDTimeProportioning(const Scalar*, const uint8_t*,  // * N Outputs and their pins, the window in
+      unsigned long, double);                          //   Milliseconds and the Output for 100% on
+
+  void Begin();                         // * sets the pins to OUTPUT and off, starts a window
+  void Update();                        // * call every loop()
+
+  void SetWindow(unsigned long);        // * in Milliseconds
+  void SetMinPulse(unsigned long);      // * shortest on or off time in Milliseconds, 0 = any
+  void SetStagger(bool);                // * spread the channels' windows over the window
+  void SetActiveLow(bool);              // * for relay boards that switch on a LOW pin
+
+  bool GetState(unsigned int i) { return state[i >> 3] & (1 << (i & 7)); }
+
+private:
+  void Write(unsigned int, bool);
+
+  const Scalar *myOutput;
+  const uint8_t *pins;
+  unsigned long window;
+  unsigned long minPulse;
+  unsigned long windowStart;
+  double scale;                         // window / FullScale
+  uint8_t state[(N + 7) / 8];           // relay i is on
+  bool stagger;
+  bool activeLow;
+};
+
+template<unsigned int N, class Scalar>
+PIDTimeProportioning<N, Scalar>::PIDTimeProportioning(const Scalar *Output, const uint8_t *Pins,
+        unsigned long Window, double FullScale)
+{
+   myOutput = Output;
+   pins = Pins;
+   window = Window > 0 ? Window : 1;
+   scale = FullScale > 0 ? window / FullScale : 0;
+   minPulse = 0;
+   stagger = false;
+   activeLow = false;
+   memset(state, 0, sizeof(state));
+   windowStart = millis();
+}
+
+template<unsigned int N, class Scalar>
+void PIDTimeProportioning<N, Scalar>::Begin()
+{
+   for (unsigned int i = 0; i < N; i++)
+   {
+      if (pins[i] == PID_RELAY_NO_PIN) continue;
+      pinMode(pins[i], OUTPUT);
+      digitalWrite(pins[i], activeLow ? HIGH : LOW);
+   }
+   memset(state, 0, sizeof(state));
+   windowStart = millis();
+}
+
+/* Update() ***********************************************************************
+ *     moves the window on if it is over, then for each channel compares where
+ *   we are in its window with its on time.  with stagger, channel i's window
+ *   starts i*Window/N later
+ **********************************************************************************/
+template<unsigned int N, class Scalar>
+void PIDTimeProportioning<N, Scalar>::Update()
+{
+   unsigned long elapsed = millis() - windowStart;
+   if (elapsed >= window)
+   {
+      unsigned long passed = elapsed - elapsed % window;
+      windowStart += passed;
+      elapsed -= passed;
+   }
+
+   unsigned long step = stagger ? window / N : 0;
+   unsigned long phase = elapsed;
+   for (unsigned int i = 0; i < N; i++)
+   {
+      double on = double(myOutput[i]) * scale;
+      unsigned long onTime = on <= 0 ? 0 : on >= window ? window : (unsigned long)on;
+      if (onTime < minPulse) onTime = 0;
+      else if (window - onTime < minPulse) onTime = window;
+
+      Write(i, phase < onTime);
+
+      //the next window starts step earlier, so we are step later in it
+      phase += step;
+      if (phase >= window) phase -= window;
+   }
+}
+
+template<unsigned int N, class Scalar>
+void PIDTimeProportioning<N, Scalar>::Write(unsigned int i, bool on)
+{
+   uint8_t bit = 1 << (i & 7);
+   if (bool(state[i >> 3] & bit) == on) return;
+   if (on) state[i >> 3] |= bit;
+   else state[i >> 3] &= ~bit;
+   if (pins[i] != PID_RELAY_NO_PIN) digitalWrite(pins[i], on != activeLow ? HIGH : LOW);
+}
+
+template<unsigned int N, class Scalar>
+void PIDTimeProportioning<N, Scalar>::SetWindow(unsigned long Window)
+{
+   if (Window == 0) return;
+   scale = scale * Window / window;
+   window = Window;
+}
+
+template<unsigned int N, class Scalar>
+void PIDTimeProportioning<N, Scalar>::SetMinPulse(unsigned long MinPulse)
+{
+   minPulse = MinPulse;
+}
+
+template<unsigned int N, class Scalar>
+void PIDTimeProportioning<N, Scalar>::SetStagger(bool Stagger)
+{
+   stagger = Stagger;
+}
+
+/* SetActiveLow(...) **************************************************************
+ *     the relays that are on now are rewritten with the new polarity
+ **********************************************************************************/
+template<unsigned int N, class Scalar>
+void PIDTimeProportioning<N, Scalar>::SetActiveLow(bool ActiveLow)
+{
+   if (ActiveLow == activeLow) return;
+   activeLow = ActiveLow;
+   for (unsigned int i = 0; i < N; i++)
+      if (pins[i] != PID_RELAY_NO_PIN) digitalWrite(pins[i], GetState(i) != activeLow ? HIGH : LOW);
+}
+
+#endif
@@ -0,0 +1,136 @@
+#ifndef PID_Schedule_h
+#define PID_Schedule_h
+
+#if ARDUINO >= 100
+  #include "Arduino.h"
+#else
+  #include "WProgram.h"
+#endif
+
+#include <stdint.h>
+#include "PID_v1.h"
+
+/**********************************************************************************
+ * BasicPIDGainSchedule<Scalar>, PIDGainSchedule
+ *
+ *    gain scheduling: the tunings follow an operating point (the Input, the
+ *  Setpoint or any other variable), interpolated linearly between the points of
+ *  a table sorted by X.  the table is kept in flash:
+ *
+ *      const PIDGainPoint ovenGains[] PROGMEM = {
+ *        //  X    Kp    Ki    Kd
+ *        {   0,  4.0,  0.2,  1.0 },
+ *        { 100,  2.0,  0.1,  0.5 },
+ *        { 250,  1.0,  0.05, 0.25 },
+ *      };
+ *      PIDGainSchedule schedule(&myPID, ovenGains, 3, &Setpoint);
+ *      ...  schedule.Update();  myPID.Compute();
+ *
+ *  below the first and above the last point the gains of that point are used.
+ *  only the segment the operating point is in is read from flash, and it is
+ *  held in RAM with its slopes, already scaled for the PID's sample time, so
+ *  while the operating point stays in it an Update() is three multiply-adds
+ *  and a SetScaledTunings().  a move to another segment walks the table from
+ *  the last one, which is only a step or two for a slowly changing X.
+ **********************************************************************************/
+
+struct PIDGainPoint
+{
+  float X;                              // * operating point, ascending through the table
+  float Kp, Ki, Kd;                     // * tunings at X, in the units of SetTunings()
+};
+
+template<class Scalar>
+class BasicPIDGainSchedule
+{
+public:
+  BasicPIDGainSchedule(BasicPID<Scalar>*,       // * the PID to schedule, a table of n points in
+      const PIDGainPoint*, uint8_t,             //   PROGMEM, and the variable to schedule on
+      const Scalar* = 0);                       //   (or 0 to only use Update(x))
+
+  void Update();                        // * sets the tunings for the linked variable
+  void Update(Scalar);                  // * sets the tunings for this operating point
+  uint8_t GetSegment() { return segment; }
+
+private:
+  void Load(uint8_t);
+
+  BasicPID<Scalar> *pid;
+  const PIDGainPoint *table;
+  const Scalar *variable;
+  uint8_t count;
+  uint8_t segment;                      // X is between point segment and segment+1
+  unsigned long sampleTime;             // the segment below is scaled for this sample time
+  Scalar x0, x1;
+  Scalar kp, ki, kd;                    // scaled gains at x0
+  Scalar dKp, dKi, dKd;                 // scaled gain change per unit of X
+};
+
+typedef BasicPIDGainSchedule<double> PIDGainSchedule;
+
+template<class Scalar>
+BasicPIDGainSchedule<Scalar>::BasicPIDGainSchedule(BasicPID<Scalar> *PID,
+        const PIDGainPoint *Table, uint8_t n, const Scalar *ScheduleOn)
+{
+   pid = PID;
+   table = Table;
+   count = n;
+   variable = ScheduleOn;
+   segment = 0;
+   if (count > 0) Load(0);   //an empty table is never read, Update() leaves the tunings alone
+}
+
+/* Load(...) **********************************************************************
+ *     copies points i and i+1 out of flash and works out the scaled gains and
+ *   slopes of that segment.  with a single point the slopes are 0
+ **********************************************************************************/
+template<class Scalar>
+void BasicPIDGainSchedule<Scalar>::Load(uint8_t i)
+{
+   PIDGainPoint a, b;
+   memcpy_P(&a, &table[i], sizeof(a));
+   if (i + 1 < count) memcpy_P(&b, &table[i + 1], sizeof(b));
+   else b = a;
+
+   segment = i;
+   sampleTime = pid->GetSampleTimeUs();
+   double sampleTimeInSec = sampleTime / 1000000.0;
+   double width = b.X > a.X ? b.X - a.X : 1;
+
+   x0 = a.X;
+   x1 = b.X;
+   kp = a.Kp;
+   ki = a.Ki * sampleTimeInSec;
+   kd = a.Kd / sampleTimeInSec;
+   dKp = (b.Kp - a.Kp) / width;
+   dKi = (b.Ki - a.Ki) * sampleTimeInSec / width;
+   dKd = (b.Kd - a.Kd) / sampleTimeInSec / width;
+}
+
+template<class Scalar>
+void BasicPIDGainSchedule<Scalar>::Update()
+{
+   if (variable) Update(*variable);
+}
+
+template<class Scalar>
+void BasicPIDGainSchedule<Scalar>::Update(Scalar x)
+{
+   if (count == 0) return;
+   uint8_t i = segment;
+   if (count > 1)
+   {
+      while (i > 0 && x < x0) Load(--i);
+      while (i + 2 < count && x > x1) Load(++i);
+   }
+   if (sampleTime != pid->GetSampleTimeUs()) Load(i);
+
+   //clamp to the ends of the table
+   Scalar t = x - x0;
+   if (t < Scalar(0)) t = 0;
+   else if (x > x1) t = x1 - x0;
+
+   pid->SetScaledTunings(kp + dKp * t, ki + dKi * t, kd + dKd * t);
+}
+
+#endif
@@ -0,0 +1,155 @@
+#ifndef PID_Scheduler_h
+#define PID_Scheduler_h
+
+#if ARDUINO >= 100
+  #include "Arduino.h"
+#else
+  #include "WProgram.h"
+#endif
+
+#include <stdint.h>
+#include "PID_v1.h"
+
+/**********************************************************************************
+ * PIDScheduler<N, Scalar>
+ *
+ *    runs up to N PIDs, each at its own sample time, from one clock read per
+ *  Run().  the controllers are kept in a min-heap ordered by the time their next
+ *  sample is due, so a Run() with nothing due is one clock read and one
+ *  comparison, and a due controller costs O(log N) to reschedule, however many
+ *  are registered:
+ *
+ *      PIDScheduler<32> scheduler;
+ *      scheduler.Add(&zone1PID);            //returns its index, for GetOverruns()
+ *      scheduler.Add(&zone2PID);
+ *      ...  in loop():  scheduler.Run();    //instead of calling Compute() on each
+ *
+ *  due controllers are computed with ComputeNow(), so their own clock isn't
+ *  read and their timing modes don't apply.  the samples stay on a fixed grid
+ *  of SampleTime steps; a sample that comes more than a whole SampleTime late
+ *  counts as an overrun, and the grid restarts from now (the missed samples are
+ *  skipped).  the sample times have to be below 35 minutes.
+ **********************************************************************************/
+template<unsigned int N, class Scalar = double>
+class PIDScheduler
+{
+  static_assert(N > 0 && N < 255, "PIDScheduler runs 1 to 254 controllers");
+
+public:
+  PIDScheduler() : count(0), timeSource(MillisAsMicros) {}
+
+  int Add(BasicPID<Scalar>*);           // * registers a PID, due right away.  returns its index,
+                                        //   or -1 if all N places are taken
+  unsigned int Run();                   // * computes the PIDs that are due, returns how many
+
+  void SetTimebase(int);
+  void SetTimeSource(unsigned long (*)());
+
+  unsigned long GetOverruns(uint8_t i) { return entries[i].overruns; }  // * late samples of PID i
+  void ResetOverruns() { for (uint8_t i = 0; i < count; i++) entries[i].overruns = 0; }
+  uint8_t GetCount() { return count; }
+
+private:
+  static unsigned long MillisAsMicros() { return millis() * 1000UL; }
+  //wrap-safe "a is due before b"
+  bool Before(uint8_t a, uint8_t b) { return (long)(entries[a].due - entries[b].due) < 0; }
+  void SiftDown(uint8_t);
+  void SiftUp(uint8_t);
+
+  struct Entry
+  {
+    BasicPID<Scalar> *pid;
+    unsigned long due;                  // time of the next sample, in Microseconds
+    unsigned long overruns;
+  };
+  Entry entries[N];                     // in the order they were added
+  uint8_t heap[N];                      // indices into entries, earliest due first
+  uint8_t count;
+  unsigned long (*timeSource)();
+};
+
+template<unsigned int N, class Scalar>
+int PIDScheduler<N, Scalar>::Add(BasicPID<Scalar> *pid)
+{
+   if (count == N) return -1;
+   uint8_t i = count++;
+   entries[i].pid = pid;
+   entries[i].due = timeSource();
+   entries[i].overruns = 0;
+   heap[i] = i;
+   SiftUp(i);
+   return i;
+}
+
+/* Run() **************************************************************************
+ *     takes the earliest controller off the top of the heap while it is due,
+ *   computes it, moves its due time one SampleTime on and sifts it back down
+ **********************************************************************************/
+template<unsigned int N, class Scalar>
+unsigned int PIDScheduler<N, Scalar>::Run()
+{
+   if (count == 0) return 0;
+   unsigned long now = timeSource();
+   unsigned int computed = 0;
+   while ((long)(now - entries[heap[0]].due) >= 0)
+   {
+      Entry &e = entries[heap[0]];
+      e.pid->ComputeNow();
+      computed++;
+
+      unsigned long period = e.pid->GetSampleTimeUs();
+      e.due += period;
+      if ((long)(now - e.due) >= 0)
+      {  //more than a period late: count it and start over from now
+         e.overruns++;
+         e.due = now + period;
+      }
+      SiftDown(0);
+   }
+   return computed;
+}
+
+template<unsigned int N, class Scalar>
+void PIDScheduler<N, Scalar>::SiftUp(uint8_t pos)
+{
+   while (pos > 0)
+   {
+      uint8_t parent = (pos - 1) / 2;
+      if (!Before(heap[pos], heap[parent])) break;
+      uint8_t t = heap[pos]; heap[pos] = heap[parent]; heap[parent] = t;
+      pos = parent;
+   }
+}
+
+template<unsigned int N, class Scalar>
+void PIDScheduler<N, Scalar>::SiftDown(uint8_t pos)
+{
+   for (;;)
+   {
+      unsigned int first = pos, left = 2 * pos + 1, right = left + 1;
+      if (left < count && Before(heap[left], heap[first])) first = left;
+      if (right < count && Before(heap[right], heap[first])) first = right;
+      if (first == pos) break;
+      uint8_t t = heap[pos]; heap[pos] = heap[first]; heap[first] = t;
+      pos = first;
+   }
+}
+
+template<unsigned int N, class Scalar>
+void PIDScheduler<N, Scalar>::SetTimebase(int Timebase)
+{
+   SetTimeSource(Timebase == PID_MICROS ? micros : MillisAsMicros);
+}
+
+/* SetTimeSource(...) *************************************************************
+ *     all controllers become due right away on the new clock
+ **********************************************************************************/
+template<unsigned int N, class Scalar>
+void PIDScheduler<N, Scalar>::SetTimeSource(unsigned long (*Clock)())
+{
+   timeSource = Clock;
+   unsigned long now = timeSource();
+   for (uint8_t i = 0; i < count; i++) entries[i].due = now;
+}
+
+#endif
@@ -0,0 +1,110 @@
+#ifndef PID_Shared_h
+#define PID_Shared_h
+
+#include <stdint.h>
+#include "PID_v1.h"
+
+/**********************************************************************************
+ * Retuning from another core
+ *
+ *    on dual core chips (ESP32, RP2040) the controller often runs on one core
+ *  while WiFi/MQTT code on the other one wants to change tunings and limits.
+ *  calling SetTunings() from there races with Compute(): the gains are written
+ *  one after the other and the control core can pick up half of a new set.
+ *
+ *    PIDTuningMailbox is a seqlock around one set of parameters.  the other core
+ *  Publish()es a complete set, the control core calls ApplyTo() right before
+ *  Compute().  ApplyTo() only takes a copy when a new set was published, checks
+ *  that the copy wasn't torn by a concurrent Publish() and then calls the
+ *  setters itself, so the PID is only ever touched by the control core.
+ *  nobody blocks: a torn copy is simply dropped and picked up at the next sample.
+ *
+ *      PIDTuningMailbox mailbox;                   //shared
+ *
+ *      //core 1                                    //core 0
+ *      PIDParameters p = {...};                    mailbox.ApplyTo(myPID);
+ *      mailbox.Publish(p);                         myPID.Compute();
+ *
+ *  there must be only one publishing task.
+ **********************************************************************************/
+
+struct PIDParameters
+{
+  double Kp, Ki, Kd;
+  int POn;                              // P_ON_E or P_ON_M
+  int Direction;                        // DIRECT or REVERSE
+  double OutMin, OutMax;
+  double IntegratorMin, IntegratorMax;
+};
+
+class PIDTuningMailbox
+{
+public:
+  PIDTuningMailbox() : sequence(0), applied(0) {}
+
+  void Publish(const PIDParameters&);   // * writer side, never blocks
+  bool Read(PIDParameters&);            // * reader side, false if a Publish() got in the way
+
+  template<class PIDType>
+  bool ApplyTo(PIDType& pid);           // * applies a newly published set, true if it did so
+
+private:
+#if defined(__AVR__)
+  typedef uint8_t Sequence;             // single byte accesses are atomic on AVR
+#else
+  typedef uint32_t Sequence;
+#endif
+
+  Sequence sequence;                    // odd while a Publish() is in progress
+  Sequence applied;                     // sequence of the set last applied (reader only)
+  PIDParameters params;
+};
+
+/* Publish(...) *******************************************************************
+ * makes the sequence odd, writes the parameters, makes it even again
+ **********************************************************************************/
+inline void PIDTuningMailbox::Publish(const PIDParameters &p)
+{
+   Sequence s = __atomic_load_n(&sequence, __ATOMIC_RELAXED);
+   __atomic_store_n(&sequence, (Sequence)(s + 1), __ATOMIC_RELAXED);
+   __atomic_thread_fence(__ATOMIC_RELEASE);
+   params = p;
+   __atomic_store_n(&sequence, (Sequence)(s + 2), __ATOMIC_RELEASE);
+}
+
+/* Read(...) **********************************************************************
+ * copies the published parameters.  the copy is only valid if the sequence was
+ * even and didn't change while copying
+ **********************************************************************************/
+inline bool PIDTuningMailbox::Read(PIDParameters &p)
+{
+   Sequence before = __atomic_load_n(&sequence, __ATOMIC_ACQUIRE);
+   if (before & 1) return false;
+   p = params;
+   __atomic_thread_fence(__ATOMIC_ACQUIRE);
+   return __atomic_load_n(&sequence, __ATOMIC_RELAXED) == before;
+}
+
+/* ApplyTo(...) *******************************************************************
+ * cheap when nothing changed: a single load and compare.  otherwise it reads
+ * the new set and hands it to the controller's setters
+ **********************************************************************************/
+template<class PIDType>
+bool PIDTuningMailbox::ApplyTo(PIDType &pid)
+{
+   Sequence before = __atomic_load_n(&sequence, __ATOMIC_ACQUIRE);
+   if (before == applied || (before & 1)) return false;
+
+   PIDParameters p = params;
+   __atomic_thread_fence(__ATOMIC_ACQUIRE);
+   if (__atomic_load_n(&sequence, __ATOMIC_RELAXED) != before) return false;
+   applied = before;
+
+   pid.SetOutputLimits(p.OutMin, p.OutMax);
+   pid.SetIntegratorLimits(p.IntegratorMin, p.IntegratorMax);
+   pid.SetControllerDirection(p.Direction);
+   pid.SetTunings(p.Kp, p.Ki, p.Kd, p.POn);
+   return true;
+}
+
+#endif
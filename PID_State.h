@@ -0,0 +1,191 @@
+#ifndef PID_State_h
+#define PID_State_h
+
+#include <stdint.h>
+#include <stddef.h>
+#include "PID_Crc.h"
+
+/**********************************************************************************
+ * Saved controller state
+ *
+ *    SaveState() copies what a PID needs to carry on where it left off into a
+ *  PIDState: tunings, limits, sample time, mode, and the integrator, input,
+ *  filter and output values.  after a reset RestoreState() puts it all back, so
+ *  the loop continues bumpless instead of rebuilding the I sum from the Output
+ *  and the filter from a single raw reading.
+ *
+ *  a PIDState is 54 bytes (56 on 32 bit targets), with a version and a CRC-16
+ *  so that an erased, half written or outdated copy is recognized and
+ *  rejected.  the settings that have a default (filters, anti-windup, deadband,
+ *  timing modes) are not part of it, they are set up in setup() as usual.
+ *  values are stored as float, whatever the Scalar of the PID.
+ *
+ *    PIDStateStore<Storage, Slots> keeps the state in EEPROM or flash and
+ *  spreads the writes over Slots copies: each save goes to the next slot with
+ *  a higher sequence number, and loading picks the newest valid one (so a
+ *  power loss during a save falls back to the previous copy).  every byte of a
+ *  slot is rewritten on its save, since the integrator, output and sequence
+ *  change each time, so a cell sees one write per Slots saves.  AVR EEPROM is
+ *  rated for about 100000 writes per cell: that is 100000*Slots saves, e.g.
+ *  16 slots (864 bytes) saved every 10 minutes last 30 years, 4 slots saved
+ *  once a minute only 9 months.  size Slots to the space that is free, save
+ *  as rarely as a restart can afford, and pass a Tolerance to Save() so that
+ *  a settled loop isn't written at all.  Storage is any class with
+ *
+ *      void Read(unsigned int address, void *data, size_t n);
+ *      void Write(unsigned int address, const void *data, size_t n);
+ *
+ *  on AVR, including EEPROM.h before this file provides PIDEEPROMStorage:
+ *
+ *      #include <EEPROM.h>
+ *      #include <PID_State.h>
+ *      PIDEEPROMStorage eeprom;
+ *      PIDStateStore<PIDEEPROMStorage, 16> store(eeprom, 0);  //16 slots from address 0
+ *
+ *      if (!store.Restore(myPID)) myPID.SetMode(AUTOMATIC);   //in setup()
+ *      ...  store.Save(myPID, 0.5);                           //every 10 minutes, if
+ *                                                             //something moved by 0.5
+ **********************************************************************************/
+
+#define PID_STATE_VERSION 1
+
+struct PIDState
+{
+  enum { FlagAuto = 1, FlagReverse = 2, FlagPonE = 4 };
+
+  uint8_t Version;
+  uint8_t Flags;
+  uint16_t Sequence;                    // * set by PIDStateStore, the highest is the newest
+  uint32_t SampleTimeUs;
+  float Kp, Ki, Kd;
+  float OutMin, OutMax;
+  float IntegratorMin, IntegratorMax;
+  float Integrator;
+  float LastInput, LastFilteredInput;
+  float LastOutput;
+  uint16_t Crc;                         // * over everything before it
+
+  uint16_t Checksum() const { return PIDCrc16((const uint8_t*)this, offsetof(PIDState, Crc)); }
+  void Seal() { Version = PID_STATE_VERSION; Crc = Checksum(); }
+  bool IsValid() const { return Version == PID_STATE_VERSION && Crc == Checksum(); }
+  bool IsNear(const PIDState&, float Tolerance) const;  // * same settings, and the integrator, inputs
+                                                        //   and output within Tolerance
+};
+
+inline bool PIDState::IsNear(const PIDState &b, float Tolerance) const
+{
+   const float values[] = { Integrator - b.Integrator, LastInput - b.LastInput,
+                            LastFilteredInput - b.LastFilteredInput, LastOutput - b.LastOutput };
+   for (uint8_t i = 0; i < 4; i++)
+      if (values[i] > Tolerance || values[i] < -Tolerance) return false;
+   return Flags == b.Flags && SampleTimeUs == b.SampleTimeUs && Kp == b.Kp && Ki == b.Ki &&
+          Kd == b.Kd && OutMin == b.OutMin && OutMax == b.OutMax &&
+          IntegratorMin == b.IntegratorMin && IntegratorMax == b.IntegratorMax;
+}
+
+template<class Scalar> class BasicPID;
+
+template<class Storage, uint8_t Slots = 4>
+class PIDStateStore
+{
+  static_assert(Slots > 0, "PIDStateStore needs at least one slot");
+
+public:
+  PIDStateStore(Storage &S, unsigned int Address)     // * uses Slots*sizeof(PIDState) bytes
+    : storage(S), address(Address), newest(-1), sequence(0) {}
+
+  void Save(PIDState&);                 // * writes to the next slot, setting Sequence and the CRC
+  bool Save(PIDState&, float Tolerance);  // * same, unless the newest copy IsNear() it.  true if written
+  bool Load(PIDState&);                 // * reads the newest valid copy, false if there is none
+
+  template<class Scalar>
+  void Save(BasicPID<Scalar> &pid) { PIDState s; pid.SaveState(s); Save(s); }
+  template<class Scalar>
+  bool Save(BasicPID<Scalar> &pid, float Tolerance) { PIDState s; pid.SaveState(s); return Save(s, Tolerance); }
+  template<class Scalar>
+  bool Restore(BasicPID<Scalar> &pid) { PIDState s; return Load(s) && pid.RestoreState(s); }
+
+  static const unsigned int Size = Slots * sizeof(PIDState);
+
+private:
+  unsigned int SlotAddress(uint8_t i) { return address + i * sizeof(PIDState); }
+  void Scan();
+
+  Storage &storage;
+  unsigned int address;
+  int8_t newest;                        // slot with the newest copy, -1 before Scan()
+  uint16_t sequence;                    // its sequence number
+};
+
+/* Scan() *************************************************************************
+ *     finds the newest valid copy.  sequence numbers wrap around, so "newer" is
+ *   decided on the difference.  with no valid copy at all the next save goes
+ *   to slot 0
+ **********************************************************************************/
+template<class Storage, uint8_t Slots>
+void PIDStateStore<Storage, Slots>::Scan()
+{
+   newest = Slots - 1;
+   sequence = 0;
+   bool found = false;
+   for (uint8_t i = 0; i < Slots; i++)
+   {
+      PIDState s;
+      storage.Read(SlotAddress(i), &s, sizeof(s));
+      if (!s.IsValid()) continue;
+      if (!found || (int16_t)(s.Sequence - sequence) > 0)
+      {
+         newest = i;
+         sequence = s.Sequence;
+         found = true;
+      }
+   }
+}
+
+template<class Storage, uint8_t Slots>
+void PIDStateStore<Storage, Slots>::Save(PIDState &s)
+{
+   if (newest < 0) Scan();
+   newest = (newest + 1) % Slots;
+   s.Sequence = ++sequence;
+   s.Seal();
+   storage.Write(SlotAddress(newest), &s, sizeof(s));
+}
+
+template<class Storage, uint8_t Slots>
+bool PIDStateStore<Storage, Slots>::Save(PIDState &s, float Tolerance)
+{
+   PIDState last;
+   if (Load(last) && last.IsNear(s, Tolerance)) return false;
+   Save(s);
+   return true;
+}
+
+template<class Storage, uint8_t Slots>
+bool PIDStateStore<Storage, Slots>::Load(PIDState &s)
+{
+   if (newest < 0) Scan();
+   storage.Read(SlotAddress(newest), &s, sizeof(s));
+   return s.IsValid();
+}
+
+#if defined(EEPROM_h) && defined(__AVR__)
+/* PIDEEPROMStorage ***************************************************************
+ *     the AVR EEPROM.  update() only writes the bytes that changed
+ **********************************************************************************/
+struct PIDEEPROMStorage
+{
+  void Read(unsigned int a, void *data, size_t n)
+  {
+     uint8_t *p = (uint8_t*)data;
+     while (n--) *p++ = EEPROM.read(a++);
+  }
+  void Write(unsigned int a, const void *data, size_t n)
+  {
+     const uint8_t *p = (const uint8_t*)data;
+     while (n--) EEPROM.update(a++, *p++);
+  }
+};
+#endif
+
+#endif
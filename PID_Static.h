@@ -0,0 +1,150 @@
+#ifndef PID_Static_h
+#define PID_Static_h
+
+#if ARDUINO >= 100
+  #include "Arduino.h"
+#else
+  #include "WProgram.h"
+#endif
+
+#include "PID_v1.h"
+
+/**********************************************************************************
+ * StaticPID<Config, Scalar>
+ *
+ *    a controller whose tunings, direction, proportional mode, filter, limits
+ *  and sample time are all fixed at compile time.  they are taken from a Config
+ *  struct that overrides some of the defaults in StaticPIDConfig:
+ *
+ *      struct OvenLoop : StaticPIDConfig {
+ *        static constexpr double Kp = 2, Ki = 5, Kd = 1;
+ *        static constexpr unsigned long SampleTimeUs = 250000;
+ *      };
+ *      StaticPID<OvenLoop> ovenPID;
+ *
+ *      ovenPID.Initialize(Input, Output);         //bumpless start
+ *      if (ovenPID.Compute(Input, Setpoint)) analogWrite(PIN_OUTPUT, ovenPID.GetOutput());
+ *
+ *  no settings are stored and nothing is checked at run time: everything is
+ *  folded into constants, terms with a zero gain disappear, and only the
+ *  controller state (integrator, last input, output, last time) takes RAM
+ *  (16 bytes with float).  the math is the same as PID::Compute().
+ **********************************************************************************/
+
+struct StaticPIDConfig
+{
+  static constexpr double Kp = 1, Ki = 0, Kd = 0;
+  static constexpr int Direction = DIRECT;
+  static constexpr int POn = P_ON_E;
+  static constexpr double FilterAlpha = 0;      // input smoothing, 0 = off (P_ON_E only)
+  static constexpr double OutMin = 0, OutMax = 255;
+  static constexpr double IntegratorMin = -100, IntegratorMax = 100;
+  static constexpr unsigned long SampleTimeUs = 100000;
+  static constexpr int Timebase = PID_MILLIS;   // PID_MILLIS or PID_MICROS
+};
+
+template<class Config, class Scalar = float>
+class StaticPID
+{
+  static_assert(Config::Kp >= 0 && Config::Ki >= 0 && Config::Kd >= 0, "tunings must not be negative");
+  static_assert(Config::OutMin < Config::OutMax, "OutMin must be below OutMax");
+  static_assert(Config::IntegratorMin < Config::IntegratorMax, "IntegratorMin must be below IntegratorMax");
+  static_assert(Config::SampleTimeUs > 0, "SampleTimeUs must not be 0");
+  static_assert(Config::Timebase == PID_MICROS || Config::SampleTimeUs % 1000 == 0,
+                "with PID_MILLIS the sample time must be whole Milliseconds");
+
+  //the working gains, scaled and signed like in PID::SetTunings()
+  static constexpr double Sign = Config::Direction == REVERSE ? -1 : 1;
+  static constexpr double SampleTimeInSec = Config::SampleTimeUs / 1000000.0;
+  static constexpr double KP = Sign * Config::Kp;
+  static constexpr double KI = Sign * Config::Ki * SampleTimeInSec;
+  static constexpr double KD = Sign * Config::Kd / SampleTimeInSec;
+  static constexpr bool PonE = Config::POn == P_ON_E;
+  static constexpr unsigned long Period = Config::Timebase == PID_MICROS ?
+                                          Config::SampleTimeUs : Config::SampleTimeUs / 1000;
+
+public:
+  StaticPID() : integrator(0), last(0), output(0), lastTime(0) {}
+
+  void Initialize(Scalar input, Scalar currentOutput);  // * bumpless start from the current output
+  bool Compute(Scalar input, Scalar setpoint);          // * computes a new output once SampleTimeUs
+                                                        //   has passed, true if it did
+  Scalar Step(Scalar input, Scalar setpoint);           // * computes a new output right away, for
+                                                        //   calling at the sample rate from a timer
+  Scalar GetOutput() { return output; }
+  Scalar GetLastIPart() { return integrator; }
+
+private:
+  static Scalar Clamp(Scalar v, Scalar lo, Scalar hi) { return v > hi ? hi : (v < lo ? lo : v); }
+  static unsigned long Now() { return Config::Timebase == PID_MICROS ? micros() : millis(); }
+
+  Scalar integrator;
+  Scalar last;                          // last filtered input in P_ON_E, last raw input in P_ON_M
+  Scalar output;
+  unsigned long lastTime;
+};
+
+template<class Config, class Scalar>
+void StaticPID<Config, Scalar>::Initialize(Scalar input, Scalar currentOutput)
+{
+   output = Clamp(currentOutput, Scalar(Config::OutMin), Scalar(Config::OutMax));
+   integrator = output;
+   last = input;
+   lastTime = Now() - Period;
+}
+
+template<class Config, class Scalar>
+bool StaticPID<Config, Scalar>::Compute(Scalar input, Scalar setpoint)
+{
+   unsigned long now = Now();
+   if (now - lastTime < Period) return false;
+   Step(input, setpoint);
+   lastTime = now;
+   return true;
+}
+
+/* Step(...) **********************************************************************
+ *     one sample of ComputeWeighted() (with b = 1, c = 0) or ComputePonM() with
+ *   every coefficient known at compile time, so the untaken mode and all zero
+ *   gain terms compile to nothing
+ **********************************************************************************/
+template<class Config, class Scalar>
+Scalar StaticPID<Config, Scalar>::Step(Scalar input, Scalar setpoint)
+{
+   const Scalar outMin = Scalar(Config::OutMin), outMax = Scalar(Config::OutMax);
+   Scalar error = setpoint - input;
+   Scalar dInput;
+
+   if (PonE)
+   {
+      //don't let the I sum grow if the output is already at its limits
+      if (KI != 0 && output < outMax - Scalar(0.01) && output > outMin + Scalar(0.01))
+         integrator += Scalar(KI) * error;
+
+      Scalar filtered = Config::FilterAlpha == 0 ? input :
+         Scalar(Config::FilterAlpha) * last + Scalar(1 - Config::FilterAlpha) * input;
+      dInput = filtered - last;
+      last = filtered;
+
+      integrator = Clamp(integrator, outMin, outMax);
+      integrator = Clamp(integrator, Scalar(Config::IntegratorMin), Scalar(Config::IntegratorMax));
+      output = Scalar(KP) * error;
+   }
+   else
+   {
+      if (KI != 0) integrator += Scalar(KI) * error;
+      dInput = input - last;
+      last = input;
+
+      //P on measurement goes into the I sum, which is only limited by the output limits
+      if (KP != 0) integrator -= Scalar(KP) * dInput;
+      integrator = Clamp(integrator, outMin, outMax);
+      output = 0;
+   }
+
+   output += KD != 0 ? integrator - Scalar(KD) * dInput : integrator;
+   output = Clamp(output, outMin, outMax);
+   return output;
+}
+
+#endif
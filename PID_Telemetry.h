@@ -0,0 +1,108 @@
+#ifndef PID_Telemetry_h
+#define PID_Telemetry_h
+
+#include <stdint.h>
+#include <stddef.h>
+
+/**********************************************************************************
+ * Per-sample telemetry
+ *
+ *    a PID can hand every sample it computes to a PIDSampleSink, set with
+ *  SetTelemetry().  PIDTelemetry<Scalar, N> is a sink that keeps the last N
+ *  samples in a fixed-size ring buffer, so a low priority task (or loop()) can
+ *  Drain() them in bulk and send them out without slowing down the controller
+ *  and without losing samples when the link is busy for a moment.
+ *  nothing is allocated, and without a sink Compute() only checks a pointer.
+ *
+ *      PIDTelemetry<double, 32> telemetry;
+ *      myPID.SetTelemetry(&telemetry);
+ *      ...
+ *      PIDSample<double> s[8];
+ *      size_t n = telemetry.Drain(s, 8);
+ *
+ *  the ring buffer is lock-free for one writer (the PID, which may run in an
+ *  ISR or on another core) and one reader.
+ **********************************************************************************/
+
+template<class Scalar>
+struct PIDSample
+{
+  unsigned long Time;                   // * timestamp of the sample, in Microseconds
+  Scalar Input;
+  Scalar FilteredInput;
+  Scalar Setpoint;
+  Scalar P, I, D;                       // * P part, integrator and D part as in GetLastPPart() etc.
+  Scalar Output;
+};
+
+template<class Scalar>
+class PIDSampleSink
+{
+public:
+  virtual void Record(const PIDSample<Scalar>&) = 0;
+};
+
+template<class Scalar, unsigned int N>
+class PIDTelemetry : public PIDSampleSink<Scalar>
+{
+public:
+  PIDTelemetry() : head(0), tail(0), dropped(0) {}
+
+  void Record(const PIDSample<Scalar>&);    // * called by the PID, drops the sample when full
+  size_t Drain(PIDSample<Scalar>*, size_t); // * moves up to n samples out, oldest first
+  size_t Available();                       // * number of samples waiting
+  unsigned long GetDropped() { return dropped; }  // * samples lost because the buffer was full
+
+private:
+#if defined(__AVR__)
+  typedef uint8_t Index;                // single byte accesses are atomic on AVR
+  static_assert(N < 255, "PIDTelemetry holds at most 254 samples on AVR");
+#else
+  typedef unsigned int Index;
+#endif
+  static Index Next(Index i) { return i == N ? 0 : i + 1; }
+
+  PIDSample<Scalar> buffer[N + 1];      // one slot is kept free to tell full from empty
+  Index head;                           // next slot to write, only changed by Record()
+  Index tail;                           // next slot to read, only changed by Drain()
+  unsigned long dropped;
+};
+
+template<class Scalar, unsigned int N>
+void PIDTelemetry<Scalar, N>::Record(const PIDSample<Scalar> &s)
+{
+   Index h = head;
+   Index next = Next(h);
+   if (next == __atomic_load_n(&tail, __ATOMIC_ACQUIRE))
+   {
+      dropped++;
+      return;
+   }
+   buffer[h] = s;
+   __atomic_store_n(&head, next, __ATOMIC_RELEASE);
+}
+
+template<class Scalar, unsigned int N>
+size_t PIDTelemetry<Scalar, N>::Drain(PIDSample<Scalar> *dst, size_t n)
+{
+   Index t = tail;
+   Index h = __atomic_load_n(&head, __ATOMIC_ACQUIRE);
+   size_t count = 0;
+   while (t != h && count < n)
+   {
+      dst[count++] = buffer[t];
+      t = Next(t);
+   }
+   __atomic_store_n(&tail, t, __ATOMIC_RELEASE);
+   return count;
+}
+
+template<class Scalar, unsigned int N>
+size_t PIDTelemetry<Scalar, N>::Available()
+{
+   Index h = __atomic_load_n(&head, __ATOMIC_ACQUIRE);
+   Index t = __atomic_load_n(&tail, __ATOMIC_ACQUIRE);
+   return h >= t ? h - t : N + 1 - t + h;
+}
+
+#endif
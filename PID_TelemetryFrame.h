@@ -0,0 +1,115 @@
+#ifndef PID_TelemetryFrame_h
+#define PID_TelemetryFrame_h
+
+#include <stdint.h>
+#include <stddef.h>
+#include "PID_Telemetry.h"
+#include "PID_Crc.h"
+
+/**********************************************************************************
+ * Binary telemetry frames
+ *
+ *    printing samples as text takes ~100 bytes per sample.  PIDFrameEncoder packs
+ *  a PIDSample into a frame of typically around 20 bytes, written to any Print or
+ *  Stream (anything with write(const uint8_t*, size_t)) or into a plain buffer.
+ *  no heap is used, the encoder only remembers the previous sample.
+ *  extras/telemetry/pid_frame_decode.py decodes a recorded stream on a PC.
+ *
+ *  Frame layout
+ *
+ *    0xA5           sync byte
+ *    length         number of bytes from type up to, but without, the CRC
+ *    type           0x01 = key frame (absolute values), 0x02 = delta frame
+ *    [scale]        key frames only: varint, values were multiplied by it
+ *    [sequence]     delta frames only: one byte, frames since the key frame (1, 2, ...)
+ *    time           varint, key frame: timestamp in us, delta frame: us since last frame
+ *    7 values       zigzag varints: Input, FilteredInput, Setpoint, P, I, D, Output,
+ *                   each round(value * scale), in delta frames minus the previous one
+ *    CRC            CRC-16/CCITT-FALSE over length..last value, low byte first
+ *
+ *  varints are little endian base 128 (7 bits per byte, high bit = more bytes
+ *  follow).  a key frame is sent first and then every KeyInterval frames, so a
+ *  decoder can resynchronize after lost bytes.  a delta frame only applies to
+ *  the frame before it: after a bad CRC or a gap in the sequence a decoder has
+ *  to drop the deltas until the next key frame.
+ **********************************************************************************/
+
+#define PID_FRAME_SYNC  0xA5
+#define PID_FRAME_KEY   0x01
+#define PID_FRAME_DELTA 0x02
+#define PID_FRAME_MAX   50              // sync + length + type + 9 varints of <= 5 bytes + CRC
+
+template<class Scalar>
+class PIDFrameEncoder
+{
+public:
+  PIDFrameEncoder(unsigned long Scale = 1000, uint8_t KeyInterval = 64)
+    : scale(Scale), keyInterval(KeyInterval), count(0) {}
+
+  size_t Encode(const PIDSample<Scalar>&, uint8_t*);  // * writes one frame of at most PID_FRAME_MAX
+                                                      //   bytes into the buffer, returns its length
+  template<class Output>
+  size_t Write(const PIDSample<Scalar> &s, Output &out)  // * encodes and writes one frame to a Print
+  {
+     uint8_t frame[PID_FRAME_MAX];
+     size_t n = Encode(s, frame);
+     out.write(frame, n);
+     return n;
+  }
+
+  void Reset() { count = 0; }           // * next frame will be a key frame
+
+private:
+  static uint8_t *PutVarint(uint8_t *p, uint32_t v)
+  {
+     while (v >= 0x80) { *p++ = (uint8_t)(v | 0x80); v >>= 7; }
+     *p++ = (uint8_t)v;
+     return p;
+  }
+  int32_t Quantize(Scalar value) const
+  {
+     double v = static_cast<double>(value) * scale;
+     if (v >= 2147483647.0) return 0x7FFFFFFFL;
+     if (v <= -2147483647.0) return -0x7FFFFFFFL;
+     return (int32_t)(v + (v >= 0 ? 0.5 : -0.5));
+  }
+
+  unsigned long scale;
+  uint8_t keyInterval;
+  uint8_t count;                        // frames since the last key frame
+  unsigned long lastTime;
+  int32_t last[7];                      // previous quantized values
+};
+
+template<class Scalar>
+size_t PIDFrameEncoder<Scalar>::Encode(const PIDSample<Scalar> &s, uint8_t *frame)
+{
+   bool key = count == 0;
+   uint8_t sequence = count;
+   if (++count >= keyInterval) count = 0;
+
+   int32_t q[7] = { Quantize(s.Input), Quantize(s.FilteredInput), Quantize(s.Setpoint),
+                    Quantize(s.P), Quantize(s.I), Quantize(s.D), Quantize(s.Output) };
+
+   uint8_t *p = frame + 2;
+   *p++ = key ? PID_FRAME_KEY : PID_FRAME_DELTA;
+   if (key) p = PutVarint(p, scale);
+   else *p++ = sequence;
+   p = PutVarint(p, key ? s.Time : s.Time - lastTime);
+   for (uint8_t i = 0; i < 7; i++)
+   {
+      int32_t d = key ? q[i] : (int32_t)((uint32_t)q[i] - (uint32_t)last[i]);
+      p = PutVarint(p, ((uint32_t)d << 1) ^ (uint32_t)(d >> 31));   //zigzag: small magnitudes -> short
+      last[i] = q[i];
+   }
+   lastTime = s.Time;
+
+   frame[0] = PID_FRAME_SYNC;
+   frame[1] = (uint8_t)(p - frame - 2);
+   uint16_t crc = PIDCrc16(frame + 1, p - frame - 1);
+   *p++ = (uint8_t)crc;
+   *p++ = (uint8_t)(crc >> 8);
+   return p - frame;
+}
+
+#endif
@@ -0,0 +1,103 @@
+#ifndef PID_Timer_h
+#define PID_Timer_h
+
+#if ARDUINO >= 100
+  #include "Arduino.h"
+#else
+  #include "WProgram.h"
+#endif
+
+/**********************************************************************************
+ * Timer driven computation
+ *
+ *    Instead of polling Compute() from loop(), a hardware timer can call
+ *  ComputeNow() of a PID (or a PIDBank) at exactly the sample rate.  the sample
+ *  time set on the controller must match the timer period, it is still used to
+ *  scale the I and D gains.
+ *
+ *  Locking
+ *    the ISR reads the Input and Setpoint and writes the Output, and it uses the
+ *  controller's internal state.  none of these are written atomically (a double
+ *  is 4 or 8 bytes), so everything the main loop does with them has to happen
+ *  with interrupts disabled: writing Input or Setpoint, reading Output, and
+ *  calling any setter.  PIDInterruptLock does that for the current scope:
+ *
+ *      double raw = analogRead(PIN_INPUT), out;
+ *      {  PIDInterruptLock lock;
+ *         Input = raw;
+ *         out = Output;  }
+ *
+ *  keep these blocks short, the ISR is delayed until the lock is released.
+ *  for retuning from another core of a multi-core chip see PID_Shared.h.
+ **********************************************************************************/
+
+/* PIDInterruptLock ***************************************************************
+ * disables interrupts while in scope.  on AVR the previous interrupt state is
+ * restored, so it can be nested and used inside ISRs
+ **********************************************************************************/
+class PIDInterruptLock
+{
+public:
+#if defined(__AVR__)
+  PIDInterruptLock() : sreg(SREG) { cli(); }
+  ~PIDInterruptLock() { SREG = sreg; }
+private:
+  uint8_t sreg;
+#else
+  PIDInterruptLock() { noInterrupts(); }
+  ~PIDInterruptLock() { interrupts(); }
+#endif
+  PIDInterruptLock(const PIDInterruptLock&);
+  PIDInterruptLock& operator=(const PIDInterruptLock&);
+};
+
+#if defined(__AVR__) && defined(TIMSK1)
+#if defined(PID_CYCLE_COUNTER) && !defined(PID_CYCLE_COUNTER_MICROS)
+  #error "PID_CYCLE_COUNTER counts cycles on Timer1, which PIDTimer1Begin() needs: also define PID_CYCLE_COUNTER_MICROS"
+#endif
+
+/* PIDTimer1Begin(...) ************************************************************
+ * sets up the 16 bit Timer1 of the ATmega328P/32U4/2560 to fire its compare
+ * match A interrupt every periodUs Microseconds (up to ~4s at 16MHz).  the ISR
+ * itself is defined with PID_TIMER1_ISR, e.g.
+ *
+ *    PID myPID(&Input, &Output, &Setpoint, 2, 5, 1, DIRECT);
+ *    PID_TIMER1_ISR(myPID)
+ *
+ *    void setup() {
+ *       myPID.SetSampleTimeUs(1000);
+ *       myPID.SetMode(AUTOMATIC);
+ *       PIDTimer1Begin(1000);
+ *    }
+ *
+ * Timer1 is also used by the Servo library and analogWrite() on pins 9 and 10,
+ * and by PID_CYCLE_COUNTER (see PID_Cycles.h), so this doesn't build with it
+ * unless PID_CYCLE_COUNTER_MICROS is defined too.
+ **********************************************************************************/
+inline bool PIDTimer1Begin(unsigned long periodUs)
+{
+   static const uint16_t prescalers[] = {1, 8, 64, 256, 1024};
+   static const uint8_t clockSelect[] = {_BV(CS10), _BV(CS11), _BV(CS11) | _BV(CS10),
+                                         _BV(CS12), _BV(CS12) | _BV(CS10)};
+   unsigned long ticks = (F_CPU / 1000000UL) * periodUs;
+   for (uint8_t i = 0; i < 5; i++)
+   {
+      unsigned long count = ticks / prescalers[i];
+      if (count == 0 || count > 65536UL) continue;
+      PIDInterruptLock lock;
+      TCCR1A = 0;
+      TCCR1B = _BV(WGM12) | clockSelect[i];   //CTC mode, TOP = OCR1A
+      TCNT1 = 0;
+      OCR1A = (uint16_t)(count - 1);
+      TIMSK1 |= _BV(OCIE1A);
+      return true;
+   }
+   return false;
+}
+
+inline void PIDTimer1End() { TIMSK1 &= ~_BV(OCIE1A); }
+
+#define PID_TIMER1_ISR(pid) ISR(TIMER1_COMPA_vect) { (pid).ComputeNow(); }
+#endif
+
+#endif
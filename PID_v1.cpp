@@ -12,38 +12,100 @@
 #endif
 
 #include <PID_v1.h>
+#include <PID_Telemetry.h>
+#include <PID_Filters.h>
+#include <PID_State.h>
 
 /*Constructor (...)*********************************************************
  *    The parameters specified here are those for for which we can't set up
  *    reliable defaults, so we need to have the user set them.
  ***************************************************************************/
-PID::PID(double *Input, double *Output, double *Setpoint,
+template<class Scalar>
+BasicPID<Scalar>::BasicPID(Scalar *Input, Scalar *Output, Scalar *Setpoint,
          double Kp, double Ki, double Kd, int POn, int ControllerDirection)
 {
    myOutput = Output;
    myInput = Input;
    mySetpoint = Setpoint;
    inAuto = false;
+   integratorHold = false;
+   antiWindup = PID_AW_HOLD;
+   trackingGain = 0;
+#if defined(PID_DEADBAND)
+   deadband = deadbandArmed = false;
+   errorBand = inputBand = 0;
+#endif
+#if defined(PID_FEED_FORWARD)
+   ffInput = 0;
+   ffTerm = ffLastInput = 0;
+   ffGain = ffLead = ffLag = 0;
+#endif
+#if defined(PID_OUTPUT_RATE_LIMIT)
+   slewRate = 0;
+   slewLimited = 0;
+#endif
+#if defined(PID_SETPOINT_WEIGHTS)
+   bWeight = 1;
+   cWeight = 0;
+   pOffset = 0;
+#endif
+#if defined(PID_VELOCITY_FORM)
+   velocity = false;
+   lastPError = 0;
+#endif
+#if defined(PID_VELOCITY_FORM) && defined(PID_FEED_FORWARD)
+   lastFfTerm = 0;
+#endif
+#if defined(PID_TIMING_MODES)
+   timed = timedArmed = measuredDt = catchUp = false;
+   maxLate = 4;
+   lastSampleTime = 0;
+#endif
+   lastSetpoint = 0;
+   pOn = P_ON_E; pOnE = true;
+   telemetry = 0;
+   inputFilter = 0;
+   lastOutput = lastRawOutput = integrator = 0;
+   lastInput = lastFilteredInput = lastDTerm = 0;
+   dTimeConstant = 0;
+#if defined(PID_CYCLE_COUNTER)
+   PIDCycleCounterBegin();
+#endif
 
-   PID::SetOutputLimits(0, 255);			   //default output limit corresponds to
-                                          //the arduino pwm limits
-   PID::SetIntegratorLimits(-100, 100);   //set default integrator limits
+   dispKp = dispKi = dispKd = 0;
+   SampleTime = 100000UL;						   //default Controller Sample Time is 0.1 seconds
 
-   SampleTime = 100;							   //default Controller Sample Time is 0.1 seconds
+   //default output limit corresponds to the arduino pwm limits, or 0-100
+   //where the Scalar can't hold 255 (PIDQ24 tops out just below 128)
+   SetOutputLimits(0, double(Scalar(255)) == 255 ? 255 : 100);
+   SetIntegratorLimits(-100, 100);   //set default integrator limits
 
-   PID::SetControllerDirection(ControllerDirection);
-   PID::SetTunings(Kp, Ki, Kd, POn);
+   timeSource = MillisAsMicros;
 
-   lastTime = millis()-SampleTime;
+   SetControllerDirection(ControllerDirection);
+   SetTunings(Kp, Ki, Kd, POn);
+
+   lastTime = timeSource()-SampleTime;
 }
 
 /*Constructor (...)*********************************************************
  *    To allow backwards compatability for v1.1, or for people that just want
  *    to use Proportional on Error without explicitly saying so
  ***************************************************************************/
-PID::PID(double *Input, double *Output, double *Setpoint,
+template<class Scalar>
+BasicPID<Scalar>::BasicPID(Scalar *Input, Scalar *Output, Scalar *Setpoint,
          double Kp, double Ki, double Kd, int ControllerDirection)
-    : PID::PID(Input, Output, Setpoint, Kp, Ki, Kd, P_ON_E, ControllerDirection)
+    : BasicPID(Input, Output, Setpoint, Kp, Ki, Kd, P_ON_E, ControllerDirection)
+{
+}
+
+/*Constructor (...)*********************************************************
+ *    For using the PID without linked variables, only through
+ *    Compute(input, setpoint, now) and SetMode(mode, input, output)
+ ***************************************************************************/
+template<class Scalar>
+BasicPID<Scalar>::BasicPID(double Kp, double Ki, double Kd, int POn, int ControllerDirection)
+    : BasicPID(0, 0, 0, Kp, Ki, Kd, POn, ControllerDirection)
 {
 }
 
@@ -53,77 +115,526 @@ PID::PID(double *Input, double *Output, double *Setpoint,
  *   pid Output needs to be computed.  returns true when the output is computed,
  *   false when nothing has been done.
  **********************************************************************************/
-bool PID::Compute()
+template<class Scalar>
+bool BasicPID<Scalar>::Compute()
+{
+#if defined(PID_CYCLE_COUNTER)
+   uint32_t start = PIDCycleCount();
+   bool computed = ComputeIfDue();
+   uint32_t cycles = PIDCycleCount() - start;
+   if (computed) computeCycles.Add(cycles);
+   else skippedCycles.Add(cycles);
+   return computed;
+#else
+   return ComputeIfDue();
+#endif
+}
+
+template<class Scalar>
+bool BasicPID<Scalar>::ComputeIfDue()
 {
    if(!inAuto) return false;
-   unsigned long now = millis();
+   unsigned long now = timeSource();
    unsigned long timeChange = (now - lastTime);
    if (timeChange>=SampleTime)
    {
-      // Compute all the working error variables
-      double input = *myInput;
-      double error = *mySetpoint - input;
-   
-      //Integral Part      
-      //added: don't let I part sum grow if output is already at max (from e.g. P alone), c.f. https://github.com/br3ttb/Arduino-PID-Library/issues/76
-      if (!pOnE || (*myOutput < outMax - 0.01 && *myOutput > outMin + 0.01)) {
-         integrator += (ki * error);
-      }
+      bool computed = ComputeAt(*myInput, *mySetpoint, now);
+      *myOutput = lastOutput;
+      return computed;
+   }
+   else return false;
+}
 
-      //use Exponentially weighted moving average as low pass filter of input data
-      double oldFiltered = lastFilteredInput;
+/* Compute(input, setpoint, now) **************************************************
+ *     the same calculation, but on values instead of the linked variables: the
+ *   caller passes the input, the setpoint and the current time (in Microseconds,
+ *   on the same clock for every call) and gets the output back.  if no sample is
+ *   due yet, or the PID is in MANUAL, the last output is returned unchanged
+ **********************************************************************************/
+template<class Scalar>
+Scalar BasicPID<Scalar>::Compute(Scalar input, Scalar setpoint, unsigned long now)
+{
+   if(!inAuto || now - lastTime < SampleTime) return velocity ? Scalar(0) : lastOutput;
+   ComputeAt(input, setpoint, now);
+   return lastOutput;
+}
+
+/* ComputeAt(...) *************************************************************
+ *     a sample that is due at now, from Compute().  the usual case: compute and
+ *   start the next period now.  with SetTimingMode() or SetOverrunPolicy() set,
+ *   ComputeTimed() instead
+ ******************************************************************************/
+template<class Scalar>
+bool BasicPID<Scalar>::ComputeAt(Scalar input, Scalar setpoint, unsigned long now)
+{
+   bool computed;
+#if defined(PID_TIMING_MODES)
+   if (timed) computed = ComputeTimed(input, setpoint, now);
+   else
+#endif
+   {
+      computed = Sample(input, setpoint);
+      lastTime = now;
+   }
+   if (computed && telemetry) Report(now, setpoint);
+   return computed;
+}
 
-      //calc new IIR filtered value
-      lastFilteredInput = filterAlpha * lastFilteredInput + (1-filterAlpha) * input;
+/* ComputeTimed(...) **********************************************************
+ *     with PID_OVERRUN_CATCH_UP the next period starts where this one should
+ *   have ended, so samples missed while the loop was busy are made up on the
+ *   following calls, unless it is MaxLate periods or more behind.  with
+ *   PID_MEASURED_DT ki and kd are rescaled for this sample by the time since
+ *   the last one (at most MaxLate periods, the rest of a longer stall is dropped).
+ *   with both, the samples that catch up come right after the late one.  one
+ *   at the same time has nothing new to integrate or differentiate, it only
+ *   moves the schedule on.  for the others the D part takes the time as at
+ *   least one period, so it isn't blown up by a dt near 0
+ ******************************************************************************/
+#if defined(PID_TIMING_MODES)
+template<class Scalar>
+bool BasicPID<Scalar>::ComputeTimed(Scalar input, Scalar setpoint, unsigned long now)
+{
+   unsigned long dt = timedArmed ? now - lastSampleTime : SampleTime;
+   lastSampleTime = now;
+   timedArmed = true;
+   if (catchUp && now - lastTime < maxGap) lastTime += SampleTime;
+   else lastTime = now;
 
-      //calc filtered input differential
-      //(the controller uses negative of derived input instead of derived error, since it's equal when assuming setpoint is constant - solves derivative kick)
-      double dInput = 0;
-      if (pOnE) {
-         dInput = (lastFilteredInput - oldFiltered) / (SampleTime/1000);
-      } else {
-         //PonM seems to need sensor noise to even start, so use unfiltered
-         dInput = input - lastInput;
-      }
+   if (!measuredDt || dt == SampleTime) return Sample(input, setpoint);
+   if (dt == 0) return false;
 
-      // Add Proportional on Measurement, if P_ON_M is specified
-      // (kp is used in additional D part (and no P part anymore) but it affects only the I sum,
-      // not the output which includes the other D part)
-      if (!pOnE) integrator-= kp * dInput;
+   if (dt > maxGap) dt = maxGap;
+   Scalar ki0 = ki, kd0 = kd;
+   ki = ki0 * Scalar((double)dt / SampleTime);
+   if (dt > SampleTime) kd = kd0 * Scalar((double)SampleTime / dt);
+   bool computed = Sample(input, setpoint);
+   ki = ki0;
+   kd = kd0;
+   return computed;
+}
+#endif
+
+/* ComputeNow() ***************************************************************
+ *     same as Compute(), but always computes a new output.  it is meant to be
+ *   called at exactly SampleTime intervals from a timer interrupt, so it doesn't
+ *   read the clock and is safe to use in an ISR.  the main loop must not change
+ *   the Input or Setpoint, read the Output or call any setter while the ISR may
+ *   run, other than inside a PIDInterruptLock (see PID_Timer.h).  the value
+ *   based one returns the new output; in MANUAL the last one, or 0 in
+ *   PID_VELOCITY form, where that is the change to apply
+ ******************************************************************************/
+template<class Scalar>
+bool BasicPID<Scalar>::ComputeNow()
+{
+   if(!inAuto) return false;
+   bool computed = Sample(*myInput, *mySetpoint);
+   if (computed && telemetry) Report(timeSource(), *mySetpoint);
+   *myOutput = lastOutput;
+   return computed;
+}
 
-      // Apply output limits to I sum (worst case anti-windup, see http://brettbeauregard.com/blog/2011/04/improving-the-beginner%e2%80%99s-pid-reset-windup/)
-      if (integrator > outMax) integrator = outMax;
-      else if (integrator < outMin) integrator = outMin;
+template<class Scalar>
+Scalar BasicPID<Scalar>::ComputeNow(Scalar input, Scalar setpoint)
+{
+   if(!inAuto) return velocity ? Scalar(0) : lastOutput;
+   if (Sample(input, setpoint) && telemetry) Report(timeSource(), setpoint);
+   return lastOutput;
+}
 
-      //limit integrator to its own limits (only if in normal PID mode, not PonM)
-      if (pOnE) {
-         if (integrator > integratorMax) integrator = integratorMax;
-         else if (integrator < integratorMin) integrator = integratorMin;
+/* ComputeBlock(...) **********************************************************
+ *     processes a whole buffer of samples that were taken SampleTime apart, as
+ *   if Compute() had been called once per sample.  the mode is only looked at
+ *   once per block and the clock isn't read at all (except for telemetry, where
+ *   the samples are timestamped backwards from now, the last one being now).
+ *   in PID_VELOCITY form Output[i] are the increments of each sample.
+ *   returns false, leaving Output untouched, when in MANUAL
+ ******************************************************************************/
+template<class Scalar>
+bool BasicPID<Scalar>::ComputeBlock(const Scalar *Input, const Scalar *Setpoint, Scalar *Output, size_t n)
+{
+   if(!inAuto) return false;
+   bool perSample = telemetry || velocity;
+#if defined(PID_DEADBAND)
+   perSample = perSample || deadband;
+#endif
+#if defined(PID_FEED_FORWARD)
+   perSample = perSample || ffInput;
+#endif
+   if (perSample)
+   {
+      unsigned long time = timeSource() - n * SampleTime;
+      for (size_t i = 0; i < n; i++)
+      {
+         time += SampleTime;
+         if (Sample(Input[i], Setpoint[i]) && telemetry) Report(time, Setpoint[i]);
+         Output[i] = lastOutput;
       }
+   }
+   else if (pOnE)
+   {
+      for (size_t i = 0; i < n; i++)
+      {
+         Output[i] = lastOutput = ComputeWeighted(Input[i], Setpoint[i]);
+         lastSetpoint = Setpoint[i];
+      }
+   }
+   else
+   {
+      for (size_t i = 0; i < n; i++) Output[i] = lastOutput = ComputePonM(Input[i], Setpoint[i]);
+      if (n > 0) lastSetpoint = Setpoint[n - 1];
+   }
+   return true;
+}
 
-      // Add Proportional on Error, if P_ON_E is specified
-      double output;
-      if (pOnE) output = kp * error;
-      else output = 0;
-
-      // Add D part to integral sum and add to output 
-      output += integrator - kd * dInput;
-
-      // Limit overall output again
-      if (output > outMax) output = outMax;
-      else if (output < outMin) output = outMin;
-      *myOutput = output;
-
-      // Remember some variables for next time
-      lastFilteredDifferential = dInput;
-      lastInput = input;
-      lastPPart = pOnE ? kp * error : 0; 
-      lastDPart = - kd * dInput;
-      lastError = error;
-      lastTime = now;
-      return true;
+/* Sample(...) ****************************************************************
+ *     one sample: unless the deadband lets it sleep, runs the kernel and
+ *   returns true.  while asleep the output and all of the state are held
+ ******************************************************************************/
+template<class Scalar>
+inline bool BasicPID<Scalar>::Sample(Scalar input, Scalar setpoint)
+{
+#if defined(PID_DEADBAND)
+   if (deadbandArmed && setpoint == lastSetpoint)
+   {
+      Scalar error = setpoint - input;
+      Scalar change = input - lastFilteredInput;
+      if (error < errorBand && error > -errorBand && change < inputBand && change > -inputBand)
+      {
+         if (velocity) lastOutput = 0;   //asleep the output doesn't move
+         return false;
+      }
    }
-   else return false;
+   deadbandArmed = deadband;
+#endif
+#if defined(PID_FEED_FORWARD)
+   if (ffInput) ffTerm = FeedForward(*ffInput);
+#endif
+   lastOutput = (this->*kernel)(input, setpoint);
+   lastSetpoint = setpoint;
+   return true;
+}
+
+#if defined(PID_OUTPUT_RATE_LIMIT)
+/* Slew(...) *****************************************************************
+ *     keeps the output within slewStep of the last one, and remembers in which
+ *   direction it had to be held back, for the anti-windup
+ ******************************************************************************/
+template<class Scalar>
+inline Scalar BasicPID<Scalar>::Slew(Scalar output)
+{
+   slewLimited = 0;
+   if (output > lastOutput + slewStep) { output = lastOutput + slewStep; slewLimited = 1; }
+   else if (output < lastOutput - slewStep) { output = lastOutput - slewStep; slewLimited = -1; }
+   return output;
+}
+#endif
+
+#if defined(PID_FEED_FORWARD)
+/* FeedForward(...) **********************************************************
+ *     Gain*(1 + Lead*s)/(1 + Lag*s) applied to the feed-forward input, with
+ *   backward Euler: y = ffA*y' + ffB0*x + ffB1*x'.  without lead-lag only the
+ *   static gain, ffB0
+ ******************************************************************************/
+template<class Scalar>
+inline Scalar BasicPID<Scalar>::FeedForward(Scalar x)
+{
+   Scalar y = ffB0 * x;
+   if (ffLeadLag) y += ffA * ffTerm + ffB1 * ffLastInput;
+   ffLastInput = x;
+   return y;
+}
+#endif
+
+/* FilterInput(...) **********************************************************
+ *     the user's filter if there is one, otherwise an exponentially weighted
+ *   moving average with the smoothing factor
+ ******************************************************************************/
+template<class Scalar>
+inline Scalar BasicPID<Scalar>::FilterInput(Scalar input)
+{
+   if (inputFilter) return inputFilter->Filter(input);
+   return filterAlpha * lastFilteredInput + filterBeta * input;
+}
+
+/* DerivativeTerm(...) *******************************************************
+ *     kd * dInput, run through the derivative filter when there is one:
+ *   kd*s/(1 + Tf*s), discretized with backward Euler
+ ******************************************************************************/
+template<class Scalar>
+inline Scalar BasicPID<Scalar>::DerivativeTerm(Scalar dInput)
+{
+   Scalar d = kd * dInput;
+   if (dAlpha != Scalar(0)) d = dAlpha * lastDTerm + dBeta * d;
+   lastDTerm = d;
+   return d;
+}
+
+/* LimitIntegrator(...) ******************************************************
+ *     clamps the I sum to the output limits and, with Own, to the integrator
+ *   limits.  the feed-forward, if compiled in, is added to the I sum for the
+ *   output, so both ranges are shifted by it: with a feed-forward of 30 and
+ *   outputs 0..255 the I sum may go from -30 to 225, enough to take back a
+ *   feed-forward that is too large, and to keep the output where it was when
+ *   the feed-forward is switched on in AUTOMATIC
+ ******************************************************************************/
+template<class Scalar>
+inline void BasicPID<Scalar>::LimitIntegrator(bool Own)
+{
+#if defined(PID_FEED_FORWARD)
+   Scalar iMax = outMax - ffTerm, iMin = outMin - ffTerm;
+#else
+   Scalar iMax = outMax, iMin = outMin;
+#endif
+   if (integrator > iMax) integrator = iMax;
+   else if (integrator < iMin) integrator = iMin;
+   if (!Own) return;
+#if defined(PID_FEED_FORWARD)
+   iMax = integratorMax - ffTerm;
+   iMin = integratorMin - ffTerm;
+#else
+   iMax = integratorMax;
+   iMin = integratorMin;
+#endif
+   if (integrator > iMax) integrator = iMax;
+   else if (integrator < iMin) integrator = iMin;
+}
+
+/* ComputeWeighted(...) / ComputePonM(...) ************************************
+ *     the actual PID calculation, one function per proportional mode so that
+ *   Compute() doesn't have to check pOnE over and over again.  the one in use
+ *   is picked by UpdateCoefficients().  both work on the coefficients cached
+ *   there and return the new output.
+ *     ComputeWeighted() is the two degree of freedom form used for P_ON_E:
+ *   P acts on b*Setpoint - Input and D on c*Setpoint - Input, I on the full
+ *   error.  the weights are plain multiplies, no branches; with the P_ON_E
+ *   defaults b = 1, c = 0 it gives exactly the classic P on error, D on
+ *   measurement result
+ ******************************************************************************/
+template<class Scalar>
+Scalar BasicPID<Scalar>::ComputeWeighted(Scalar input, Scalar setpoint)
+{
+   // Compute all the working error variables
+   Scalar error = setpoint - input;
+
+   //Integral Part, with the anti-windup set by SetAntiWindup()
+   Scalar dI = ki * error;
+   switch (integration)
+   {
+      case PID_AW_HOLD:
+         //don't let I part sum grow if output is already at max (from e.g. P alone), c.f. https://github.com/br3ttb/Arduino-PID-Library/issues/76
+         if (lastOutput < holdMax && lastOutput > holdMin && !slewLimited) integrator += dI;
+         break;
+      case PID_AW_CONDITIONAL:
+         //only stop the part that would push the output further into the limit
+         if (!((lastOutput >= holdMax || slewLimited > 0) && dI > Scalar(0)) &&
+             !((lastOutput <= holdMin || slewLimited < 0) && dI < Scalar(0))) integrator += dI;
+         break;
+      case PID_AW_BACK_CALCULATION:
+         //bleed off what the limits cut from the last output
+         integrator += dI + kt * (lastOutput - lastRawOutput);
+         break;
+      default:
+         integrator += dI;
+         break;
+   }
+
+   //low pass filter the input (see FilterInput())
+   Scalar oldFiltered = lastFilteredInput;
+   lastFilteredInput = FilterInput(input);
+
+   //calc filtered input differential
+   //(the controller uses negative of derived input instead of derived error, since it's equal when assuming setpoint is constant - solves derivative kick)
+   //kd already holds the division by the sample time, see SetTunings()
+   Scalar dInput = lastFilteredInput - oldFiltered;
+
+   // Apply output limits to I sum (worst case anti-windup, see http://brettbeauregard.com/blog/2011/04/improving-the-beginner%e2%80%99s-pid-reset-windup/)
+   // and its own limits, both less the feed-forward that is added to it (see LimitIntegrator())
+   LimitIntegrator(true);
+
+   // Proportional on the weighted error, D part on the weighted error change (with c = 0
+   // the negative input change, no derivative kick) and integral sum
+#if defined(PID_SETPOINT_WEIGHTS)
+   Scalar pTerm = kp * (bWeight * setpoint - input) + pOffset;
+   Scalar dTerm = DerivativeTerm(dInput - cWeight * (setpoint - lastSetpoint));
+#else
+   Scalar pTerm = kp * error;
+   Scalar dTerm = DerivativeTerm(dInput);
+#endif
+   Scalar output = pTerm;
+#if defined(PID_FEED_FORWARD)
+   output += integrator - dTerm + ffTerm;
+#else
+   output += integrator - dTerm;
+#endif
+   lastRawOutput = output;
+
+   // Limit overall output again
+   if (output > outMax) output = outMax;
+   else if (output < outMin) output = outMin;
+#if defined(PID_OUTPUT_RATE_LIMIT)
+   if (slewStep > Scalar(0)) output = Slew(output);
+#endif
+
+   // Remember some variables for next time
+   lastInput = input;
+#if !defined(PID_NO_DIAGNOSTICS)
+   lastFilteredDifferential = dInput;
+   lastPPart = pTerm;
+   lastDPart = - dTerm;
+   lastError = error;
+#endif
+   return output;
+}
+
+template<class Scalar>
+Scalar BasicPID<Scalar>::ComputePonM(Scalar input, Scalar setpoint)
+{
+   Scalar error = setpoint - input;
+   if (!integratorHold && !slewLimited) integrator += (ki * error);
+
+   //the filter is kept up to date so switching to P_ON_E is bumpless, but
+   //PonM seems to need sensor noise to even start, so use unfiltered
+   lastFilteredInput = FilterInput(input);
+   Scalar dInput = input - lastInput;
+
+   // Add Proportional on Measurement
+   // (kp is used in additional D part (and no P part anymore) but it affects only the I sum,
+   // not the output which includes the other D part)
+   integrator -= kp * dInput;
+
+   // Apply output limits to I sum (the integrator limits don't apply, it holds the P part too)
+   LimitIntegrator(false);
+
+   // Add D part to integral sum
+   Scalar dTerm = DerivativeTerm(dInput);
+#if defined(PID_FEED_FORWARD)
+   Scalar output = integrator - dTerm + ffTerm;
+#else
+   Scalar output = integrator - dTerm;
+#endif
+
+   if (output > outMax) output = outMax;
+   else if (output < outMin) output = outMin;
+#if defined(PID_OUTPUT_RATE_LIMIT)
+   if (slewStep > Scalar(0)) output = Slew(output);
+#endif
+
+   lastInput = input;
+#if !defined(PID_NO_DIAGNOSTICS)
+   lastFilteredDifferential = dInput;
+   lastPPart = 0;
+   lastDPart = - dTerm;
+   lastError = error;
+#else
+   (void)error;
+#endif
+   return output;
+}
+
+#if defined(PID_VELOCITY_FORM)
+/* ComputeVelocity(...) ******************************************************
+ *     the velocity (incremental) form: returns how much the output should
+ *   change, from the change of the weighted error (P), the error itself (I)
+ *   and the change of the D part, which needs only the last P error, filtered
+ *   input and D part.  there is no I sum to wind up or to initialize, and a
+ *   new kp only scales the next change, so tuning changes are bumpless.  a
+ *   change is at most the width of the output range either way, the rate
+ *   limit bounds it further
+ ******************************************************************************/
+template<class Scalar>
+Scalar BasicPID<Scalar>::ComputeVelocity(Scalar input, Scalar setpoint)
+{
+   Scalar error = setpoint - input;
+   Scalar pError = pWeight * setpoint - input;
+
+   Scalar oldFiltered = lastFilteredInput;
+   lastFilteredInput = FilterInput(input);
+   Scalar dInput = lastFilteredInput - oldFiltered;
+   Scalar oldDTerm = lastDTerm;
+#if defined(PID_SETPOINT_WEIGHTS)
+   Scalar dDelta = DerivativeTerm(dInput - dWeight * (setpoint - lastSetpoint)) - oldDTerm;
+#else
+   Scalar dDelta = DerivativeTerm(dInput) - oldDTerm;
+#endif
+
+   Scalar pDelta = kp * (pError - lastPError);
+   Scalar delta = pDelta - dDelta;
+#if defined(PID_FEED_FORWARD)
+   delta += ffTerm - lastFfTerm;
+   lastFfTerm = ffTerm;
+#endif
+   if (!integratorHold) delta += ki * error;
+   lastPError = pError;
+   lastRawOutput = delta;
+
+   if (delta > deltaMax) delta = deltaMax;
+   else if (delta < -deltaMax) delta = -deltaMax;
+#if defined(PID_OUTPUT_RATE_LIMIT)
+   if (slewStep > Scalar(0))
+   {
+      if (delta > slewStep) delta = slewStep;
+      else if (delta < -slewStep) delta = -slewStep;
+   }
+#endif
+
+   lastInput = input;
+#if !defined(PID_NO_DIAGNOSTICS)
+   lastFilteredDifferential = dInput;
+   lastPPart = pDelta;
+   lastDPart = - dDelta;
+   lastError = error;
+#endif
+   return delta;
+}
+#endif
+
+/* UpdateCoefficients() *******************************************************
+ * recalculates everything Compute() needs that only changes with the settings,
+ * called by the setters so none of it has to be done per sample
+ ******************************************************************************/
+template<class Scalar>
+void BasicPID<Scalar>::UpdateCoefficients()
+{
+#if defined(PID_VELOCITY_FORM)
+   kernel = velocity ? &BasicPID::ComputeVelocity : pOnE ? &BasicPID::ComputeWeighted : &BasicPID::ComputePonM;
+   deltaMax = outMax - outMin;
+#if defined(PID_SETPOINT_WEIGHTS)
+   pWeight = pOnE ? bWeight : Scalar(0);
+   dWeight = pOnE ? cWeight : Scalar(0);
+#else
+   pWeight = pOnE ? Scalar(1) : Scalar(0);
+#endif
+#else
+   kernel = pOnE ? &BasicPID::ComputeWeighted : &BasicPID::ComputePonM;
+#endif
+   filterBeta = Scalar(1) - filterAlpha;
+   holdMax = outMax - Scalar(0.01);
+   holdMin = outMin + Scalar(0.01);
+   integration = antiWindup;
+   if (integratorHold)
+   {  //an empty range, so P_ON_E never integrates
+      integration = PID_AW_HOLD;
+      holdMax = outMin;
+      holdMin = outMax;
+   }
+   double sampleTimeInSec = (double)SampleTime / 1000000;
+   dAlpha = dTimeConstant > 0 ? dTimeConstant / (dTimeConstant + sampleTimeInSec) : 0;
+   dBeta = Scalar(1) - dAlpha;
+   double tracking = trackingGain > 0 ? trackingGain : (dispKp > 0 ? dispKi / dispKp : 0);
+   kt = tracking * sampleTimeInSec;
+#if defined(PID_OUTPUT_RATE_LIMIT)
+   slewStep = slewRate * sampleTimeInSec;
+#endif
+#if defined(PID_TIMING_MODES)
+   maxGap = SampleTime > ~0UL / maxLate ? ~0UL : maxLate * SampleTime;
+#endif
+#if defined(PID_FEED_FORWARD)
+   ffLeadLag = ffLead > 0 || ffLag > 0;
+   ffA = ffLag / (sampleTimeInSec + ffLag);
+   ffB0 = ffGain * (sampleTimeInSec + ffLead) / (sampleTimeInSec + ffLag);
+   ffB1 = -ffGain * ffLead / (sampleTimeInSec + ffLag);
+#endif
 }
 
 /* SetTunings(...)*************************************************************
@@ -131,7 +642,8 @@ bool PID::Compute()
  * it's called automatically from the constructor, but tunings can also
  * be adjusted on the fly during normal operation
  ******************************************************************************/
-void PID::SetTunings(double Kp, double Ki, double Kd, int POn)
+template<class Scalar>
+void BasicPID<Scalar>::SetTunings(double Kp, double Ki, double Kd, int POn)
 {
    if (Kp<0 || Ki<0 || Kd<0) return;
 
@@ -140,7 +652,7 @@ void PID::SetTunings(double Kp, double Ki, double Kd, int POn)
 
    dispKp = Kp; dispKi = Ki; dispKd = Kd;
 
-   double SampleTimeInSec = ((double)SampleTime)/1000;
+   double SampleTimeInSec = ((double)SampleTime)/1000000;
    kp = Kp;
    ki = Ki * SampleTimeInSec;
    kd = Kd / SampleTimeInSec;
@@ -152,32 +664,154 @@ void PID::SetTunings(double Kp, double Ki, double Kd, int POn)
       kd = (0 - kd);
    }
 
+#if defined(PID_SETPOINT_WEIGHTS)
+   if (!pOnE) {integrator += pOffset; pOffset = 0;}   //P_ON_M has no P term to hold it
+#endif
    if (Ki == 0) {integrator = 0;}
+   UpdateCoefficients();
 }
 
 /* SetTunings(...)*************************************************************
  * Set Tunings using the last-rembered POn setting
  ******************************************************************************/
-void PID::SetTunings(double Kp, double Ki, double Kd){
+template<class Scalar>
+void BasicPID<Scalar>::SetTunings(double Kp, double Ki, double Kd){
    SetTunings(Kp, Ki, Kd, pOn); 
 }
 
+/* SetScaledTunings(...) *****************************************************
+ * like SetTunings(), but Ki and Kd come in already scaled for the sample time,
+ * so changing them only takes the direction and a conversion for GetKi() and
+ * GetKd().  the I sum is kept even if Ki is 0, so a schedule that passes
+ * through Ki = 0 doesn't bump the output
+ ******************************************************************************/
+template<class Scalar>
+void BasicPID<Scalar>::SetScaledTunings(Scalar Kp, Scalar Ki, Scalar Kd)
+{
+   if (Kp < Scalar(0) || Ki < Scalar(0) || Kd < Scalar(0)) return;
+   double SampleTimeInSec = ((double)SampleTime)/1000000;
+   dispKp = double(Kp);
+   dispKi = double(Ki) / SampleTimeInSec;
+   dispKd = double(Kd) * SampleTimeInSec;
+
+   bool reverse = controllerDirection == REVERSE;
+   kp = reverse ? -Kp : Kp;
+   ki = reverse ? -Ki : Ki;
+   kd = reverse ? -Kd : Kd;
+   if (antiWindup == PID_AW_BACK_CALCULATION && trackingGain == 0) UpdateCoefficients();
+}
+
 /* SetSampleTime(...) *********************************************************
  * sets the period, in Milliseconds, at which the calculation is performed
  ******************************************************************************/
-void PID::SetSampleTime(int NewSampleTime)
+template<class Scalar>
+void BasicPID<Scalar>::SetSampleTime(int NewSampleTime)
+{
+   if (NewSampleTime > 0) SetSampleTimeUs((unsigned long)NewSampleTime * 1000UL);
+}
+
+/* SetSampleTimeUs(...) *******************************************************
+ * sets the period, in Microseconds, at which the calculation is performed.
+ * combine with SetTimebase(PID_MICROS) for loops running at more than 1kHz,
+ * with the millisecond timebase the period is only met to within 1ms
+ ******************************************************************************/
+template<class Scalar>
+void BasicPID<Scalar>::SetSampleTimeUs(unsigned long NewSampleTime)
 {
    if (NewSampleTime > 0)
    {
       double ratio  = (double)NewSampleTime / (double)SampleTime;
       ki *= ratio;
       kd /= ratio;
-      SampleTime = (unsigned long)NewSampleTime;
+      SampleTime = NewSampleTime;
+      UpdateCoefficients();
    }
 }
 
-void PID::SetSmoothingFactor(double alpha) {
+/* SetTimebase(...) ***********************************************************
+ * selects the clock Compute() checks the sample time against: millis()
+ * (PID_MILLIS, the default) or micros() (PID_MICROS).  either way the time is
+ * handled in Microseconds internally, so both wrap around correctly.
+ ******************************************************************************/
+template<class Scalar>
+void BasicPID<Scalar>::SetTimebase(int Timebase)
+{
+   timeSource = Timebase == PID_MICROS ? micros : MillisAsMicros;
+   lastTime = timeSource()-SampleTime;
+}
+
+/* SetTimeSource(...) *********************************************************
+ * replaces millis()/micros() with a user supplied clock that returns
+ * Microseconds, e.g. a simulated time when running the library on a PC
+ ******************************************************************************/
+template<class Scalar>
+void BasicPID<Scalar>::SetTimeSource(unsigned long (*Clock)())
+{
+   timeSource = Clock;
+   lastTime = timeSource()-SampleTime;
+}
+
+template<class Scalar>
+unsigned long BasicPID<Scalar>::MillisAsMicros() { return millis() * 1000UL; }
+
+template<class Scalar>
+void BasicPID<Scalar>::SetSmoothingFactor(double alpha) {
    filterAlpha = alpha;
+   UpdateCoefficients();
+}
+
+/* SetDerivativeFilter(...) **************************************************
+ * filters only the D part, so P and I see the raw input and high-rate loops
+ * don't need heavy input smoothing (which delays every term) just to quiet the
+ * derivative.  Tf is the filter time constant in seconds; in the N factor
+ * form, Tf = Td/N = Kd/(Kp*N), with N typically 5 to 20
+ ******************************************************************************/
+template<class Scalar>
+void BasicPID<Scalar>::SetDerivativeFilter(double Tf)
+{
+   if (Tf < 0) return;
+   dTimeConstant = Tf;
+   UpdateCoefficients();
+}
+
+/* SetInputFilter(...) *******************************************************
+ * Filter takes over from the smoothing factor for the filtered input (see
+ * PID_Filters.h), 0 switches back.  the new filter starts settled on the
+ * current filtered input, so the switch doesn't kick the D part
+ ******************************************************************************/
+template<class Scalar>
+void BasicPID<Scalar>::SetInputFilter(PIDInputFilter<Scalar> *Filter)
+{
+   inputFilter = Filter;
+   if (inputFilter) inputFilter->Reset(lastFilteredInput);
+}
+
+/* SetTelemetry(...) *********************************************************
+ * hands every computed sample to Sink (see PID_Telemetry.h), or to nobody if 0
+ ******************************************************************************/
+template<class Scalar>
+void BasicPID<Scalar>::SetTelemetry(PIDSampleSink<Scalar> *Sink)
+{
+   telemetry = Sink;
+}
+
+template<class Scalar>
+void BasicPID<Scalar>::Report(unsigned long now, Scalar setpoint)
+{
+   PIDSample<Scalar> s;
+   s.Time = now;
+   s.Input = lastInput;
+   s.FilteredInput = lastFilteredInput;
+   s.Setpoint = setpoint;
+#if !defined(PID_NO_DIAGNOSTICS)
+   s.P = lastPPart;
+   s.D = lastDPart;
+#else
+   s.P = s.D = 0;
+#endif
+   s.I = integrator;
+   s.Output = lastOutput;
+   telemetry->Record(s);
 }
 
 /* SetOutputLimits(...)****************************************************
@@ -188,23 +822,25 @@ void PID::SetSmoothingFactor(double alpha) {
  *  want to clamp it from 0-125.  who knows.  at any rate, that can all be done
  *  here.
  **************************************************************************/
-void PID::SetOutputLimits(double Min, double Max)
+template<class Scalar>
+void BasicPID<Scalar>::SetOutputLimits(double Min, double Max)
 {
    if(Min >= Max) return;
    outMin = Min;
    outMax = Max;
+   UpdateCoefficients();
 
-   if(inAuto)
+   if(inAuto && !velocity)   //in PID_VELOCITY the last Output is a change, not a setting
    {
-      if (*myOutput > outMax) *myOutput = outMax;
-      else if (*myOutput < outMin) *myOutput = outMin;
-
-      if (integrator > outMax) integrator = outMax;
-      else if (integrator < outMin) integrator = outMin;
+      if (lastOutput > outMax) lastOutput = outMax;
+      else if (lastOutput < outMin) lastOutput = outMin;
+      if (myOutput) *myOutput = lastOutput;
+      LimitIntegrator(false);
    }
 }
 
-void PID::SetIntegratorLimits(double Min, double Max)
+template<class Scalar>
+void BasicPID<Scalar>::SetIntegratorLimits(double Min, double Max)
 {
    if (Min >= Max) return;
    integratorMin = Min;
@@ -212,9 +848,246 @@ void PID::SetIntegratorLimits(double Min, double Max)
 
    if (inAuto)
    {
-      if (integrator > integratorMax) integrator = integratorMax;
-      else if (integrator < integratorMin) integrator = integratorMin;
+#if defined(PID_FEED_FORWARD)
+      Scalar iMax = integratorMax - ffTerm, iMin = integratorMin - ffTerm;
+#else
+      Scalar iMax = integratorMax, iMin = integratorMin;
+#endif
+      if (integrator > iMax) integrator = iMax;
+      else if (integrator < iMin) integrator = iMin;
+   }
+}
+
+#if defined(PID_VELOCITY_FORM)
+/* SetOutputForm(...) ********************************************************
+ * PID_POSITIONAL (default): the Output is the actuator setting.  PID_VELOCITY:
+ * the Output is the change to apply to the actuator this sample, for steppers,
+ * motorized valves and other actuators that take increments.  only apply it
+ * when Compute() returns true; the value based Compute() returns 0 when there
+ * is no sample.  the output limits stay the range of the actuator, so the
+ * change per sample is at most their width either way (255 for the default
+ * 0..255), and SetOutputRateLimit() sets a smaller step.  an actuator at its
+ * end stop just doesn't move, so there is nothing to wind up.
+ * switching to PID_VELOCITY in AUTOMATIC is bumpless.  coming back, start the
+ * I sum from the actuator position with SetMode(MANUAL) and
+ * SetMode(AUTOMATIC, Input, Position)
+ ******************************************************************************/
+template<class Scalar>
+void BasicPID<Scalar>::SetOutputForm(int Form)
+{
+   bool newVelocity = Form == PID_VELOCITY;
+   if (newVelocity == velocity) return;
+   velocity = newVelocity;
+#if defined(PID_SETPOINT_WEIGHTS)
+   pOffset = 0;
+#endif
+   UpdateCoefficients();
+   if (inAuto && velocity)
+   {
+      lastPError = pWeight * lastSetpoint - lastInput;
+#if defined(PID_FEED_FORWARD)
+      lastFfTerm = ffTerm;
+#endif
+      lastOutput = 0;
+   }
+}
+#endif
+
+#if defined(PID_TIMING_MODES)
+/* SetTimingMode(...) ********************************************************
+ * PID_NOMINAL_DT (default): I and D assume every sample is exactly SampleTime
+ * after the last one, however late Compute() was called.  PID_MEASURED_DT:
+ * they use the measured time, so a busy loop that calls Compute() whenever it
+ * gets to it still integrates and differentiates correctly.  the derivative
+ * filter and back-calculation keep their nominal coefficients
+ ******************************************************************************/
+template<class Scalar>
+void BasicPID<Scalar>::SetTimingMode(int Mode)
+{
+   measuredDt = Mode == PID_MEASURED_DT;
+   timed = measuredDt || catchUp;
+   timedArmed = false;
+}
+
+/* SetOverrunPolicy(...) *****************************************************
+ * what a late sample does to the schedule.  PID_OVERRUN_SKIP (default): the
+ * next period starts now, the missed samples are lost.  PID_OVERRUN_CATCH_UP:
+ * the periods stay on their grid and the missed samples are computed on the
+ * next calls, so the number of samples over time stays right.  in either case
+ * a sample MaxLate (>= 1) or more periods late counts as a stall that isn't
+ * made up for, see ComputeTimed()
+ ******************************************************************************/
+template<class Scalar>
+void BasicPID<Scalar>::SetOverrunPolicy(int Policy, unsigned int MaxLate)
+{
+   if (MaxLate < 1) return;
+   catchUp = Policy == PID_OVERRUN_CATCH_UP;
+   maxLate = MaxLate;
+   UpdateCoefficients();
+   timed = measuredDt || catchUp;
+}
+#endif
+
+#if defined(PID_FEED_FORWARD)
+/* SetFeedForward(...) *******************************************************
+ * adds Gain times a measured disturbance (or its lead-lag, see below) to the
+ * output, before the output limits, so the anti-windup sees the total.  the
+ * gain is in output units per input unit and its sign is used as it is,
+ * whatever the controller direction.  0 for the variable turns it off.
+ * switching it on or off in AUTOMATIC moves the difference into the I sum,
+ * so the output doesn't jump
+ ******************************************************************************/
+template<class Scalar>
+void BasicPID<Scalar>::SetFeedForward(Scalar *Disturbance, double Gain)
+{
+   if (inAuto) integrator += ffTerm;
+   ffInput = Disturbance;
+   ffGain = Gain;
+   UpdateCoefficients();
+   ffTerm = 0;
+   if (ffInput)
+   {
+      ffLastInput = *ffInput;
+      ffTerm = Scalar(ffGain) * ffLastInput;
+      if (inAuto) integrator -= ffTerm;
+   }
+}
+
+/* SetFeedForwardLeadLag(...) ************************************************
+ * dynamic feed-forward Gain*(1 + Lead*s)/(1 + Lag*s), time constants in
+ * seconds, for when the disturbance acts faster (Lead) or slower (Lag) than
+ * the output.  0, 0 (the default) is the static gain only
+ ******************************************************************************/
+template<class Scalar>
+void BasicPID<Scalar>::SetFeedForwardLeadLag(double Lead, double Lag)
+{
+   if (Lead < 0 || Lag < 0) return;
+   ffLead = Lead;
+   ffLag = Lag;
+   UpdateCoefficients();
+}
+#endif
+
+#if defined(PID_SETPOINT_WEIGHTS)
+/* SetSetpointWeights(...) **************************************************
+ * two degree of freedom P_ON_E: P acts on b*Setpoint - Input and D on
+ * c*Setpoint - Input.  b = 1, c = 0 (the default) is the classic P_ON_E.
+ * lowering b makes setpoint steps gentler (less overshoot) without slowing
+ * down the response to disturbances, which only the tunings set; b = 0 is the
+ * positional form of proportional on measurement.  c > 0 brings back part of
+ * the derivative kick on setpoint steps.  changing b in AUTOMATIC moves the
+ * difference into the I sum, so the output doesn't jump, also where the I sum
+ * limits can't take all of it, see TransferToIntegrator().  P_ON_M keeps its
+ * own kernel and ignores the weights (in PID_VELOCITY form it is b = c = 0)
+ ******************************************************************************/
+template<class Scalar>
+void BasicPID<Scalar>::SetSetpointWeights(double b, double c)
+{
+   if (b < 0 || c < 0) return;
+   Scalar newB = b;
+   if (inAuto && pOnE)
+   {
+#if defined(PID_VELOCITY_FORM)
+      if (velocity) lastPError += (newB - bWeight) * lastSetpoint;
+      else
+#endif
+      TransferToIntegrator(kp * (bWeight - newB) * lastSetpoint);
    }
+   bWeight = newB;
+   cWeight = c;
+   UpdateCoefficients();
+}
+
+/* TransferToIntegrator(...) ************************************************
+ * adds Amount to the I sum for a bumpless change of settings.  the part that
+ * the output or integrator limits would cut off (e.g. a setpoint of 200 with
+ * Kp 2 and b going from 1 to 0.5 moves 200 into an I sum limited to 0..255)
+ * is held in pOffset instead, a constant next to the P term, so the output
+ * stays where it was.  Initialize() starts the I sum over without it, and
+ * leaving P_ON_E moves it into the I sum
+ ******************************************************************************/
+template<class Scalar>
+void BasicPID<Scalar>::TransferToIntegrator(Scalar Amount)
+{
+   Scalar total = integrator + pOffset + Amount;
+   integrator = total;
+   LimitIntegrator(true);
+   pOffset = total - integrator;
+}
+#endif
+
+#if defined(PID_OUTPUT_RATE_LIMIT)
+/* SetOutputRateLimit(...) **************************************************
+ * limits how fast the output may change, in output units per second, to
+ * spare actuators the steps.  the limit works inside Compute(), so the
+ * anti-windup knows about it: while the output is held back the I sum stops
+ * growing in that direction (PID_AW_HOLD, PID_AW_CONDITIONAL and P_ON_M), and
+ * back-calculation sees the difference.  0 (the default) turns it off
+ ******************************************************************************/
+template<class Scalar>
+void BasicPID<Scalar>::SetOutputRateLimit(double Rate)
+{
+   if (Rate < 0) return;
+   slewRate = Rate;
+   slewLimited = 0;
+   UpdateCoefficients();
+}
+#endif
+
+/* SetDeadband(...) **********************************************************
+ * event mode for loops that sit at the setpoint most of the time: while the
+ * error stays within +-ErrorBand and the input within +-InputBand of the last
+ * filtered input, samples are skipped, holding the output and the I sum, and
+ * Compute() returns false.  a change of the setpoint always computes.
+ * 0 for either band (the default) turns it off
+ ******************************************************************************/
+#if defined(PID_DEADBAND)
+template<class Scalar>
+void BasicPID<Scalar>::SetDeadband(double ErrorBand, double InputBand)
+{
+   if (ErrorBand < 0 || InputBand < 0) return;
+   errorBand = ErrorBand;
+   inputBand = InputBand;
+   deadband = ErrorBand > 0 && InputBand > 0;
+   deadbandArmed = false;
+}
+#endif
+
+/* SetAntiWindup(...) ********************************************************
+ * selects what keeps the I sum from winding up while the output is at a limit
+ * (P_ON_E; in P_ON_M the I sum holds the whole output and is simply clamped):
+ *   PID_AW_HOLD               stop integrating while the last output was at a
+ *                             limit (the default, as before)
+ *   PID_AW_CLAMP              always integrate, the I sum is only clamped to the
+ *                             output and integrator limits
+ *   PID_AW_CONDITIONAL        at a limit, only integrate errors that pull the
+ *                             output back into range, so it recovers at once
+ *   PID_AW_BACK_CALCULATION   feed back Kt*(limited - unlimited output) into the
+ *                             I sum, which tracks the limit with time constant 1/Kt.
+ *                             Kt = 0 uses Ki/Kp (tracking time = Ti)
+ * all of them still clamp the I sum to the limits afterwards
+ ******************************************************************************/
+template<class Scalar>
+void BasicPID<Scalar>::SetAntiWindup(int Mode, double Kt)
+{
+   if (Mode < PID_AW_HOLD || Mode > PID_AW_BACK_CALCULATION || Kt < 0) return;
+   antiWindup = Mode;
+   trackingGain = Kt;
+   lastRawOutput = lastOutput;
+   UpdateCoefficients();
+}
+
+/* SetIntegratorHold(...) ****************************************************
+ * while held the I sum keeps its value (in P_ON_M the P part, which goes
+ * through the I sum, still acts).  used by PIDCascade to stop the outer loop
+ * from winding up while the inner one is saturated
+ ******************************************************************************/
+template<class Scalar>
+void BasicPID<Scalar>::SetIntegratorHold(bool Hold)
+{
+   if (Hold == integratorHold) return;
+   integratorHold = Hold;
+   UpdateCoefficients();
 }
 
 /* SetMode(...)****************************************************************
@@ -222,27 +1095,69 @@ void PID::SetIntegratorLimits(double Min, double Max)
  * when the transition from manual to auto occurs, the controller is
  * automatically initialized
  ******************************************************************************/
-void PID::SetMode(int Mode)
+template<class Scalar>
+void BasicPID<Scalar>::SetMode(int Mode)
 {
    bool newAuto = (Mode == AUTOMATIC);
    if (newAuto && !inAuto)
    {  // we just went from manual to auto
-      PID::Initialize();
+      if (myOutput) Initialize(*myInput, *myOutput);
+      else Initialize(lastInput, lastOutput);
    }
    inAuto = newAuto;
 }
 
+/* SetMode(mode, input, output) ***********************************************
+ * for PIDs used without linked variables: on the switch to automatic the
+ * controller starts from the given input and output
+ ******************************************************************************/
+template<class Scalar>
+void BasicPID<Scalar>::SetMode(int Mode, Scalar Input, Scalar Output)
+{
+   bool newAuto = (Mode == AUTOMATIC);
+   if (newAuto && !inAuto) Initialize(Input, Output);
+   inAuto = newAuto;
+}
+
 /* Initialize()****************************************************************
  *	does all the things that need to happen to ensure a bumpless transfer
  *  from manual to automatic mode.
  ******************************************************************************/
-void PID::Initialize()
+template<class Scalar>
+void BasicPID<Scalar>::Initialize(Scalar Input, Scalar Output)
 {
-   integrator = *myOutput;
-   lastInput = lastFilteredInput = *myInput;
-
-   if (integrator > outMax) integrator = outMax;
-   else if (integrator < outMin) integrator = outMin;
+   integrator = lastOutput = lastRawOutput = Output;
+#if defined(PID_SETPOINT_WEIGHTS)
+   pOffset = 0;
+#endif
+   lastInput = lastFilteredInput = Input;
+   if (inputFilter) inputFilter->Reset(Input);
+   if (mySetpoint) lastSetpoint = *mySetpoint;   //no D kick from a setpoint changed in MANUAL
+   lastDTerm = 0;
+#if defined(PID_DEADBAND)
+   deadbandArmed = false;
+#endif
+#if defined(PID_TIMING_MODES)
+   timedArmed = false;
+#endif
+#if defined(PID_OUTPUT_RATE_LIMIT)
+   slewLimited = 0;
+#endif
+#if defined(PID_FEED_FORWARD)
+   if (ffInput)
+   {  //the feed-forward settled on its input, the I sum makes up the rest
+      ffLastInput = *ffInput;
+      ffTerm = Scalar(ffGain) * ffLastInput;
+      integrator -= ffTerm;
+   }
+#endif
+#if defined(PID_VELOCITY_FORM)
+   lastPError = pWeight * lastSetpoint - Input;  //for PID_VELOCITY: no P kick on the first sample
+#endif
+#if defined(PID_VELOCITY_FORM) && defined(PID_FEED_FORWARD)
+   lastFfTerm = ffTerm;
+#endif
+   LimitIntegrator(false);
 }
 
 /* SetControllerDirection(...)*************************************************
@@ -251,7 +1166,8 @@ void PID::Initialize()
  * know which one, because otherwise we may increase the output when we should
  * be decreasing.  This is called from the constructor.
  ******************************************************************************/
-void PID::SetControllerDirection(int Direction)
+template<class Scalar>
+void BasicPID<Scalar>::SetControllerDirection(int Direction)
 {
    if (inAuto && Direction != controllerDirection)
    {
@@ -262,19 +1178,117 @@ void PID::SetControllerDirection(int Direction)
    controllerDirection = Direction;
 }
 
+/* SaveState(...) ************************************************************
+ * fills in everything but the Sequence, and seals it with the CRC
+ ******************************************************************************/
+template<class Scalar>
+void BasicPID<Scalar>::SaveState(PIDState &State)
+{
+   State.Flags = (inAuto ? PIDState::FlagAuto : 0) |
+                 (controllerDirection == REVERSE ? PIDState::FlagReverse : 0) |
+                 (pOnE ? PIDState::FlagPonE : 0);
+   State.SampleTimeUs = SampleTime;
+   State.Kp = dispKp;
+   State.Ki = dispKi;
+   State.Kd = dispKd;
+   State.OutMin = float(outMin);
+   State.OutMax = float(outMax);
+   State.IntegratorMin = float(integratorMin);
+   State.IntegratorMax = float(integratorMax);
+#if defined(PID_SETPOINT_WEIGHTS)
+   State.Integrator = float(integrator + pOffset);
+#else
+   State.Integrator = float(integrator);
+#endif
+   State.LastInput = float(lastInput);
+   State.LastFilteredInput = float(lastFilteredInput);
+   State.LastOutput = float(lastOutput);
+   State.Seal();
+}
+
+/* RestoreState(...) *********************************************************
+ * applies the saved settings with the PID in manual, so none of the setters
+ * touch the state, then puts the state back and the mode without going
+ * through Initialize().  the Output is set to the saved one
+ ******************************************************************************/
+template<class Scalar>
+bool BasicPID<Scalar>::RestoreState(const PIDState &State)
+{
+   if (!State.IsValid() || State.SampleTimeUs == 0) return false;
+
+   inAuto = false;
+   SetSampleTimeUs(State.SampleTimeUs);
+   controllerDirection = State.Flags & PIDState::FlagReverse ? REVERSE : DIRECT;
+   SetTunings(State.Kp, State.Ki, State.Kd, State.Flags & PIDState::FlagPonE ? P_ON_E : P_ON_M);
+   SetOutputLimits(State.OutMin, State.OutMax);
+   SetIntegratorLimits(State.IntegratorMin, State.IntegratorMax);
+
+   integrator = State.Integrator;
+#if defined(PID_SETPOINT_WEIGHTS)
+   pOffset = 0;
+#endif
+   lastInput = State.LastInput;
+   lastFilteredInput = State.LastFilteredInput;
+   lastOutput = lastRawOutput = State.LastOutput;
+   if (inputFilter) inputFilter->Reset(lastFilteredInput);
+   if (mySetpoint) lastSetpoint = *mySetpoint;  //no D kick with c > 0, as in Initialize()
+   lastDTerm = 0;
+#if defined(PID_DEADBAND)
+   deadbandArmed = false;
+#endif
+#if defined(PID_TIMING_MODES)
+   timedArmed = false;
+#endif
+#if defined(PID_FEED_FORWARD)
+   if (ffInput)
+   {
+      ffLastInput = *ffInput;
+      ffTerm = Scalar(ffGain) * ffLastInput;
+   }
+#endif
+#if defined(PID_SETPOINT_WEIGHTS)
+   if (pOnE) TransferToIntegrator(0);  //a saved P offset back out of the I sum limits
+#endif
+#if defined(PID_VELOCITY_FORM)
+   lastPError = pWeight * lastSetpoint - lastInput;  //for PID_VELOCITY, as in Initialize()
+#endif
+#if defined(PID_VELOCITY_FORM) && defined(PID_FEED_FORWARD)
+   lastFfTerm = ffTerm;
+#endif
+   if (myOutput) *myOutput = lastOutput;
+   inAuto = State.Flags & PIDState::FlagAuto;
+   return true;
+}
+
 /* Status Funcions*************************************************************
  * Just because you set the Kp=-1 doesn't mean it actually happened.  these
  * functions query the internal state of the PID.  they're here for display
  * purposes.  this are the functions the PID Front-end uses for example
  ******************************************************************************/
-double PID::GetKp(){ return  dispKp; }
-double PID::GetKi(){ return  dispKi;}
-double PID::GetKd(){ return  dispKd;}
-int PID::GetMode(){ return  inAuto ? AUTOMATIC : MANUAL;}
-int PID::GetDirection() { return controllerDirection; }
-bool PID::GetPonE() { return pOnE; }
-double PID::GetDeltaInput() { return lastFilteredDifferential; }
-double PID::GetInputError() { return lastError; }
-double PID::GetLastPPart() { return lastPPart; }
-double PID::GetLastIPart() { return integrator; }
-double PID::GetLastDPart() { return lastDPart; }
+template<class Scalar> double BasicPID<Scalar>::GetKp(){ return  dispKp; }
+template<class Scalar> double BasicPID<Scalar>::GetKi(){ return  dispKi;}
+template<class Scalar> double BasicPID<Scalar>::GetKd(){ return  dispKd;}
+template<class Scalar> int BasicPID<Scalar>::GetMode(){ return  inAuto ? AUTOMATIC : MANUAL;}
+template<class Scalar> int BasicPID<Scalar>::GetDirection() { return controllerDirection; }
+template<class Scalar> bool BasicPID<Scalar>::GetPonE() { return pOnE; }
+template<class Scalar> Scalar BasicPID<Scalar>::GetLastIPart() { return integrator; }
+#if defined(PID_FEED_FORWARD)
+template<class Scalar> Scalar BasicPID<Scalar>::GetFeedForward() { return ffTerm; }
+#endif
+template<class Scalar> bool BasicPID<Scalar>::IsSaturated() { return lastOutput >= outMax || lastOutput <= outMin; }
+#if !defined(PID_NO_DIAGNOSTICS)
+template<class Scalar> Scalar BasicPID<Scalar>::GetDeltaInput() { return lastFilteredDifferential; }
+template<class Scalar> Scalar BasicPID<Scalar>::GetInputError() { return lastError; }
+template<class Scalar> Scalar BasicPID<Scalar>::GetLastPPart() { return lastPPart; }
+template<class Scalar> Scalar BasicPID<Scalar>::GetLastDPart() { return lastDPart; }
+#endif
+
+/* Instantiations *************************************************************
+ * the controller code lives here rather than in the header, so the scalar
+ * types it can be used with are instantiated explicitly.  unused ones are
+ * dropped by the linker.
+ ******************************************************************************/
+template class BasicPID<double>;
+template class BasicPID<float>;
+template class BasicPID<PIDQ16_16>;
+template class BasicPID<PIDQ8_24>;
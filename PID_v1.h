@@ -2,7 +2,42 @@
 #define PID_v1_h
 #define LIBRARY_VERSION	1.2.1
 
-class PID
+// Build options.  these change the layout of the controller, so they have to be
+// set for the whole build (e.g. build_flags in platformio.ini, or right here),
+// not just in the sketch
+//#define PID_CYCLE_COUNTER             // measure execution times of Compute(), see PID_Cycles.h
+//#define PID_NO_DIAGNOSTICS            // drop GetDeltaInput(), GetLastPPart(), GetLastDPart() and
+                                        // GetInputError() and the 4 values behind them
+
+// Optional features.  each one is only compiled in when it is defined, so a
+// plain PID doesn't carry the state of features it never uses
+//#define PID_DEADBAND                  // SetDeadband()
+//#define PID_TIMING_MODES              // SetTimingMode(), SetOverrunPolicy()
+//#define PID_FEED_FORWARD              // SetFeedForward(), SetFeedForwardLeadLag()
+//#define PID_OUTPUT_RATE_LIMIT         // SetOutputRateLimit()
+//#define PID_SETPOINT_WEIGHTS          // SetSetpointWeights()
+//#define PID_VELOCITY_FORM             // SetOutputForm()
+
+#include <stddef.h>
+#include "PID_Fixed.h"
+#if defined(PID_CYCLE_COUNTER)
+  #include "PID_Cycles.h"
+#endif
+
+template<class Scalar> class PIDSampleSink;   // see PID_Telemetry.h
+template<class Scalar> class PIDInputFilter;  // see PID_Filters.h
+struct PIDState;                              // see PID_State.h
+
+/* BasicPID<Scalar> **************************************************************
+ *    The controller is templated on the type used for the linked Input, Output
+ *  and Setpoint variables and for all of the per-sample math.  double, float
+ *  and the PIDFixed<> formats from PID_Fixed.h are instantiated in PID_v1.cpp.
+ *  Tuning parameters and limits are always passed as double; they are only
+ *  converted to Scalar when they are set, never in Compute().
+ *  PID is BasicPID<double>, so existing sketches keep working unchanged.
+ **********************************************************************************/
+template<class Scalar>
+class BasicPID
 {
   //Constants used in some of the functions below
   #define AUTOMATIC	1
@@ -11,32 +46,97 @@ class PID
   #define REVERSE  1
   #define P_ON_M 0
   #define P_ON_E 1
+  #define PID_MILLIS 0
+  #define PID_MICROS 1
+  #define PID_AW_HOLD 0                 // anti-windup modes, see SetAntiWindup()
+  #define PID_AW_CLAMP 1
+  #define PID_AW_CONDITIONAL 2
+  #define PID_AW_BACK_CALCULATION 3
+  #define PID_NOMINAL_DT 0              // timing modes, see SetTimingMode()
+  #define PID_MEASURED_DT 1
+  #define PID_OVERRUN_SKIP 0            // overrun policies, see SetOverrunPolicy()
+  #define PID_OVERRUN_CATCH_UP 1
+  #define PID_POSITIONAL 0              // output forms, see SetOutputForm()
+  #define PID_VELOCITY 1
 
 public:
   //commonly used functions **************************************************************************
-  PID(double*, double*, double*,        // * constructor.  links the PID to the Input, Output, and 
+  BasicPID(Scalar*, Scalar*, Scalar*,   // * constructor.  links the PID to the Input, Output, and 
       double, double, double, int, int);//   Setpoint.  Initial tuning parameters are also set here.
                                         //   (overload for specifying proportional mode)
 
-  PID(double*, double*, double*,        // * constructor.  links the PID to the Input, Output, and 
+  BasicPID(Scalar*, Scalar*, Scalar*,   // * constructor.  links the PID to the Input, Output, and 
       double, double, double, int);     //   Setpoint.  Initial tuning parameters are also set here
+
+  BasicPID(double, double, double,      // * constructor for a PID without linked variables, which is
+      int, int);                        //   only used through Compute(input, setpoint, now)
   
   bool Compute();                       // * performs the PID calculation.  it should be
                                         //   called every time loop() cycles. ON/OFF and
                                         //   calculation frequency can be set using SetMode
                                         //   SetSampleTime respectively
 
+  bool ComputeNow();                    // * performs the PID calculation right away, without
+                                        //   looking at the clock. for calling from a timer
+                                        //   interrupt at the sample rate, see PID_Timer.h
+
+  Scalar Compute(Scalar, Scalar,        // * value based Compute(): takes input, setpoint and the
+      unsigned long);                   //   time in Microseconds, returns the (new or last) output
+  Scalar ComputeNow(Scalar, Scalar);    // * value based ComputeNow(): input, setpoint -> output
+  bool ComputeBlock(const Scalar*,      // * runs n consecutive samples, one SampleTime apart,
+      const Scalar*, Scalar*, size_t);  //   from buffers of inputs and setpoints into a buffer
+                                        //   of outputs (e.g. a DMA filled ADC buffer)
+
 
   //Setters
   void SetMode(int Mode);               // * sets PID to either Manual (0) or Auto (non-0)
+  void SetMode(int Mode, Scalar, Scalar); // * same, starting from the given input and output
+                                          //   (for PIDs without linked variables)
 
-  void SetOutputLimits(double, double); // * clamps the output to a specific range. 0-255 by default, but
+  void SetOutputLimits(double, double); // * clamps the output to a specific range. 0-255 by default
+                                      //   (0-100 for PIDQ24, which only reaches +-128), but
                                       //   it's likely the user will want to change this depending on
                                       //   the application
 
   void SetIntegratorLimits(double, double); // * clamps the integrator to a specific range. 0-255 by default, but
                                           //   a smaller value than the output might be useful for anti-windup
 
+  void SetAntiWindup(int, double = 0);  // * how the I sum is kept from winding up while the output
+                                          //   is limited: PID_AW_HOLD (default), PID_AW_CLAMP,
+                                          //   PID_AW_CONDITIONAL or PID_AW_BACK_CALCULATION with
+                                          //   the tracking gain Kt in 1/s (0: Ki/Kp)
+
+#if defined(PID_VELOCITY_FORM)
+  void SetOutputForm(int);              // * PID_POSITIONAL (default) or PID_VELOCITY: the Output is
+                                          //   the change per sample, for actuators taking increments
+#endif
+
+#if defined(PID_SETPOINT_WEIGHTS)
+  void SetSetpointWeights(double, double); // * 2DOF P_ON_E: P acts on b*Setpoint-Input, D on
+                                          //   c*Setpoint-Input.  1, 0 (default) = plain P_ON_E
+#endif
+
+#if defined(PID_OUTPUT_RATE_LIMIT)
+  void SetOutputRateLimit(double);      // * the output changes by at most this much per second.
+                                          //   0 (default) = no limit
+#endif
+
+#if defined(PID_FEED_FORWARD)
+  void SetFeedForward(Scalar*, double); // * links a measured disturbance whose effect is added to the
+                                          //   output (times the gain) before the output limits
+  void SetFeedForwardLeadLag(double,    // * lead and lag time constants (seconds) of the feed-forward
+      double);                            //   path, Gain*(1 + Lead*s)/(1 + Lag*s).  0, 0 = static
+#endif
+
+#if defined(PID_DEADBAND)
+  void SetDeadband(double, double);     // * skips samples while |error| and the input change stay
+                                          //   below these bands (and the setpoint doesn't change),
+                                          //   holding the output.  0 turns it off
+#endif
+
+  void SetIntegratorHold(bool);         // * true freezes the I sum (e.g. while a downstream loop is
+                                          //   saturated, see PID_Cascade.h), false lets it run again
+
 
   //available but not commonly used functions ********************************************************
   void SetTunings(double, double,       // * While most users will set the tunings once in the 
@@ -44,6 +144,9 @@ public:
                                           //   of changing tunings during runtime for Adaptive control
   void SetTunings(double, double,       // * overload for specifying proportional mode
                     double, int);         	  
+  void SetScaledTunings(Scalar, Scalar, // * sets the working gains directly, ki already multiplied
+                    Scalar);              //   and kd divided by the sample time in seconds.  for
+                                          //   changing the tunings often, e.g. from PID_Schedule.h
 
   void SetControllerDirection(int);	  // * Sets the Direction, or "Action" of the controller. DIRECT
                       //   means the output will increase when error is positive. REVERSE
@@ -51,9 +154,36 @@ public:
                       //   once it is set in the constructor.
   void SetSampleTime(int);              // * sets the frequency, in Milliseconds, with which 
                                           //   the PID calculation is performed.  default is 100
+  void SetSampleTimeUs(unsigned long);  // * same, in Microseconds, for loops faster than 1kHz
+
+  void SetTimebase(int);                // * PID_MILLIS (default) or PID_MICROS: which clock
+                                          //   Compute() uses to decide when a sample is due.
+                                          //   use PID_MICROS for sample times below a few ms
+  void SetTimeSource(unsigned long (*)()); // * any other clock, returning Microseconds. mainly to
+                                          //   run the library off-target with a simulated time
+#if defined(PID_TIMING_MODES)
+  void SetTimingMode(int);              // * PID_NOMINAL_DT (default) or PID_MEASURED_DT: scale I and D
+                                          //   by the measured time between samples, for calling
+                                          //   Compute() whenever the loop gets around to it
+  void SetOverrunPolicy(int,            // * PID_OVERRUN_SKIP (default) or PID_OVERRUN_CATCH_UP: make up
+      unsigned int = 4);                  //   for late samples on the next calls.  samples this many
+                                          //   periods late or more count as a stall
+#endif
                       
   // Set smoothing factor for input low pass filtering (e.g. 0.9, the higher, the more filtering)
   void SetSmoothingFactor(double alpha);
+  void SetInputFilter(PIDInputFilter<Scalar>*); // * replaces the smoothing above with another filter,
+                                          //   e.g. a PIDBiquad or PIDMedian. 0 goes back to it
+  void SetDerivativeFilter(double);     // * first order low pass on the D part only, with this
+                                          //   time constant in seconds (Kd/(Kp*N) for the usual
+                                          //   N factor).  0, the default, turns it off
+
+  void SetTelemetry(PIDSampleSink<Scalar>*); // * every computed sample is passed to this sink,
+                                          //   e.g. a PIDTelemetry ring buffer. 0 turns it off
+
+  void SaveState(PIDState&);            // * copies tunings, limits, mode and the controller state out,
+  bool RestoreState(const PIDState&);   //   and back in for a bumpless warm start after a reset.
+                                          //   false (nothing changed) if the copy isn't valid
 
   //Getters
   double GetKp();						  // These functions query the pid for interal values.
@@ -62,48 +192,179 @@ public:
   int GetMode();						  //  inside the PID.
   int GetDirection();					//
   bool GetPonE();
-  double GetDeltaInput();     // Get dInput used for calculating D term
-  double GetLastPPart();      // Get internal PID integrator value 
-  double GetLastIPart();      // Get internal PID integrator value 
-  double GetLastDPart();      // Get internal PID integrator value 
-  double GetInputError();
+  unsigned long GetSampleTimeUs() { return SampleTime; }
+  unsigned long GetTime() { return timeSource(); }  // * now on the PID's clock, in Microseconds
+  Scalar GetOutputMin() { return outMin; }
+  Scalar GetOutputMax() { return outMax; }
+  bool IsSaturated();                   // * true if the last output was at one of the output limits
+#if defined(PID_FEED_FORWARD)
+  Scalar GetFeedForward();              // * the feed-forward part of the last output
+#endif
+  Scalar GetLastIPart();      // Get internal PID integrator value 
+#if !defined(PID_NO_DIAGNOSTICS)
+  Scalar GetDeltaInput();     // Get dInput used for calculating D term
+  Scalar GetLastPPart();      // Get internal PID integrator value 
+  Scalar GetLastDPart();      // Get internal PID integrator value 
+  Scalar GetInputError();
+#endif
+
+#if defined(PID_CYCLE_COUNTER)
+  const PIDCycleStats& GetComputeCycles() { return computeCycles; }  // Compute() calls that computed
+  const PIDCycleStats& GetSkippedCycles() { return skippedCycles; }  // Compute() calls that didn't
+  void ResetCycleStats() { computeCycles.Reset(); skippedCycles.Reset(); }
+#endif
 
 private:
-  void Initialize();
+  void Initialize(Scalar, Scalar);
+  bool ComputeIfDue();
+  void UpdateCoefficients();
+  void Report(unsigned long, Scalar);
+  bool ComputeAt(Scalar, Scalar, unsigned long);
+#if defined(PID_TIMING_MODES)
+  bool ComputeTimed(Scalar, Scalar, unsigned long);
+#endif
+  bool Sample(Scalar, Scalar);
+  Scalar ComputeWeighted(Scalar, Scalar);
+  Scalar ComputePonM(Scalar, Scalar);
+#if defined(PID_VELOCITY_FORM)
+  Scalar ComputeVelocity(Scalar, Scalar);
+#endif
+  Scalar FilterInput(Scalar);
+#if defined(PID_FEED_FORWARD)
+  Scalar FeedForward(Scalar);
+#endif
+#if defined(PID_OUTPUT_RATE_LIMIT)
+  Scalar Slew(Scalar);
+#endif
+  Scalar DerivativeTerm(Scalar);
+#if defined(PID_SETPOINT_WEIGHTS)
+  void TransferToIntegrator(Scalar);
+#endif
+  void LimitIntegrator(bool);
+  static unsigned long MillisAsMicros();
   
   double dispKp;				// * we'll hold on to the tuning parameters in user-entered 
   double dispKi;				//   format for display purposes
   double dispKd;				//
     
-  double kp;                  // * (P)roportional Tuning Parameter
-  double ki;                  // * (I)ntegral Tuning Parameter
-  double kd;                  // * (D)erivative Tuning Parameter
+  Scalar kp;                  // * (P)roportional Tuning Parameter
+  Scalar ki;                  // * (I)ntegral Tuning Parameter
+  Scalar kd;                  // * (D)erivative Tuning Parameter
 
   int controllerDirection;
   int pOn;
 
-  double *myInput;              // * Pointers to the Input, Output, and Setpoint variables
-  double *myOutput;             //   This creates a hard link between the variables and the 
-  double *mySetpoint;           //   PID, freeing the user from having to constantly tell us
+  Scalar *myInput;              // * Pointers to the Input, Output, and Setpoint variables
+  Scalar *myOutput;             //   This creates a hard link between the variables and the 
+  Scalar *mySetpoint;           //   PID, freeing the user from having to constantly tell us
                                 //   what these values are.  with pointers we'll just know.
         
+  PIDSampleSink<Scalar> *telemetry;
+  PIDInputFilter<Scalar> *inputFilter;
+#if defined(PID_FEED_FORWARD)
+  Scalar *ffInput;              // feed-forward disturbance, 0 = none
+#endif
+
+  unsigned long (*timeSource)();  // clock used by Compute(), always returns Microseconds
   unsigned long lastTime;
-  double integrator;             // Integrator sum used in compute loop method
+  Scalar integrator;             // Integrator sum used in compute loop method
+  Scalar lastOutput;             // output of the last sample, used for anti-windup
 
   //filter smoothing factor: roughly, the higher the value, the lower are the allowed frequencies to pass (but the longer the delay for changes to have an effect)
-  double filterAlpha = 0.9;
-
-  double lastInput;
-  double lastFilteredInput;
-  double lastFilteredDifferential;
-  double lastError;
-  double lastPPart;
-  double lastDPart;
-
-  unsigned long SampleTime;
-  double outMin, outMax;
-  double integratorMin, integratorMax;
+  Scalar filterAlpha = 0.9;
+
+  //coefficients derived from the settings, see UpdateCoefficients()
+  Scalar (BasicPID::*kernel)(Scalar, Scalar);  // ComputeWeighted, ComputePonM or ComputeVelocity
+  Scalar filterBeta;                           // 1-filterAlpha
+  Scalar holdMax, holdMin;                     // output range in which the I sum may grow
+  Scalar dAlpha, dBeta;                        // derivative filter, dAlpha = Tf/(Tf+SampleTime)
+  Scalar kt;                                   // back-calculation gain per sample
+#if defined(PID_FEED_FORWARD)
+  Scalar ffA, ffB0, ffB1;                      // feed-forward lead-lag, see FeedForward()
+#endif
+#if defined(PID_OUTPUT_RATE_LIMIT)
+  Scalar slewStep;                             // largest output change per sample, 0 = no limit
+#endif
+#if defined(PID_VELOCITY_FORM)
+  Scalar pWeight;                              // PID_VELOCITY: setpoint weight of P in effect, 0 in P_ON_M
+  Scalar deltaMax;                             // PID_VELOCITY: largest change per sample, outMax-outMin
+#endif
+#if defined(PID_VELOCITY_FORM) && defined(PID_SETPOINT_WEIGHTS)
+  Scalar dWeight;                              // the same for D
+#endif
+  int integration;                             // anti-windup mode used, PID_AW_HOLD when held
+
+  Scalar lastInput;
+  Scalar lastFilteredInput;
+  Scalar lastDTerm;              // kd*dInput after the derivative filter
+  double dTimeConstant;          // derivative filter time constant in seconds, 0 = off
+  Scalar lastRawOutput;          // output of the last sample before the output limits
+  int antiWindup;
+  double trackingGain;           // Kt of PID_AW_BACK_CALCULATION in 1/s, 0 = Ki/Kp
+#if defined(PID_DEADBAND)
+  Scalar errorBand, inputBand;   // deadband, see SetDeadband()
+#endif
+  Scalar lastSetpoint;           // setpoint of the last computed sample
+#if defined(PID_SETPOINT_WEIGHTS)
+  Scalar bWeight, cWeight;       // setpoint weights of P and D, see SetSetpointWeights()
+  Scalar pOffset;                // part of a weight change the I sum limits didn't take, see TransferToIntegrator()
+#endif
+#if defined(PID_VELOCITY_FORM)
+  Scalar lastPError;             // PID_VELOCITY: weighted error and feed-forward part of the last sample
+#if defined(PID_FEED_FORWARD)
+  Scalar lastFfTerm;
+#endif
+  bool velocity;                 // PID_VELOCITY output form
+#else
+  enum { velocity = 0 };         // always PID_POSITIONAL, so the form checks fold away
+#endif
+#if defined(PID_FEED_FORWARD)
+  Scalar ffTerm, ffLastInput;    // feed-forward part of the output, and its input, last sample
+  double ffGain, ffLead, ffLag;
+#endif
+#if defined(PID_OUTPUT_RATE_LIMIT)
+  double slewRate;               // output units per second
+  int8_t slewLimited;            // last output was held back by the rate limit: +1 rising, -1 falling
+#else
+  enum { slewLimited = 0 };      // never held back, so the anti-windup conditions fold away
+#endif
+#if defined(PID_TIMING_MODES)
+  unsigned long lastSampleTime;  // when the last sample was computed, for PID_MEASURED_DT
+  unsigned int maxLate;          // periods after which a late sample counts as a stall
+  unsigned long maxGap;          // maxLate*SampleTime, held at the largest time instead of wrapping
+#endif
+#if !defined(PID_NO_DIAGNOSTICS)
+  Scalar lastFilteredDifferential;
+  Scalar lastError;
+  Scalar lastPPart;
+  Scalar lastDPart;
+#endif
+
+  unsigned long SampleTime;      // in Microseconds
+#if defined(PID_CYCLE_COUNTER)
+  PIDCycleStats computeCycles, skippedCycles;
+#endif
+  Scalar outMin, outMax;
+  Scalar integratorMin, integratorMax;
   bool inAuto, pOnE;
+  bool integratorHold;
+#if defined(PID_DEADBAND)
+  bool deadband;
+  bool deadbandArmed;            // a sample was computed with the deadband on, so the next may sleep
+#endif
+#if defined(PID_FEED_FORWARD)
+  bool ffLeadLag;
+#endif
+#if defined(PID_TIMING_MODES)
+  bool measuredDt, catchUp;
+  bool timed;                    // measuredDt || catchUp
+  bool timedArmed;               // lastSampleTime is valid
+#endif
 };
 
+typedef BasicPID<double> PID;           // the classic controller
+typedef BasicPID<float> PIDf;           // same as PID on AVR, single precision on ARM
+typedef BasicPID<PIDQ16_16> PIDQ16;     // fixed-point, for FPU-less targets
+typedef BasicPID<PIDQ8_24> PIDQ24;      // fixed-point with more resolution, inputs within +-128
+
 #endif
@@ -0,0 +1,66 @@
+/********************************************************
+ * PID AutoTune Example
+ * Tunes the PID with a relay experiment when a button is
+ * pressed: the output swings 50 up and down around where
+ * it is until the input oscillates steadily around the
+ * setpoint, then the tunings are calculated from that
+ * oscillation and the PID carries on with them.
+ ********************************************************/
+
+#include <PID_v1.h>
+#include <PID_AutoTune.h>
+
+#define PIN_INPUT 0
+#define PIN_OUTPUT 3
+#define PIN_BUTTON 2
+
+//Define Variables we'll be connecting to
+double Setpoint, Input, Output;
+
+//Specify the links and initial tuning parameters
+PID myPID(&Input, &Output, &Setpoint, 2, 5, 1, DIRECT);
+PIDAutoTune tuner(&myPID, &Input, &Output);
+bool tuning = false;
+
+void setup()
+{
+  Serial.begin(9600);
+  pinMode(PIN_BUTTON, INPUT_PULLUP);
+
+  //initialize the variables we're linked to
+  Input = analogRead(PIN_INPUT);
+  Setpoint = 100;
+
+  //turn the PID on
+  myPID.SetMode(AUTOMATIC);
+}
+
+void loop()
+{
+  Input = analogRead(PIN_INPUT);
+
+  if (digitalRead(PIN_BUTTON) == LOW && !tuning)
+  {  //Output +-50, ignore input noise below 2
+    tuner.Start(Setpoint, 50, 2, PID_TUNE_TL_PID);
+    tuning = true;
+  }
+
+  if (tuning)
+  {
+    int state = tuner.Runtime();
+    if (state != PID_TUNE_RUNNING)
+    {  //done: the tuner has set the new tunings and turned the PID back on
+      tuning = false;
+      if (state == PID_TUNE_DONE)
+      {
+        Serial.print("Kp: "); Serial.print(myPID.GetKp());
+        Serial.print(" Ki: "); Serial.print(myPID.GetKi());
+        Serial.print(" Kd: "); Serial.println(myPID.GetKd());
+      }
+    }
+  }
+
+  //does nothing while the tuner has the PID in MANUAL
+  myPID.Compute();
+  analogWrite(PIN_OUTPUT, Output);
+}
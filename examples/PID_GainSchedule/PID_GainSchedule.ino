@@ -0,0 +1,50 @@
+/********************************************************
+ * PID Gain Schedule Example
+ * Like the Adaptive Tunings example, but instead of jumping
+ * between two sets of tunings, the tunings follow the
+ * distance from the setpoint smoothly: they are
+ * interpolated from a table in flash, aggressive far from
+ * the setpoint and conservative close to it.
+ ********************************************************/
+
+#include <PID_v1.h>
+#include <PID_Schedule.h>
+
+#define PIN_INPUT 0
+#define PIN_OUTPUT 3
+
+//Define Variables we'll be connecting to
+double Setpoint, Input, Output, Gap;
+
+//Tunings by distance from the setpoint
+const PIDGainPoint gains[] PROGMEM = {
+  // Gap   Kp    Ki    Kd
+  {    0,  1,    0.05, 0.25 },
+  {   10,  1,    0.05, 0.25 },
+  {   40,  4,    0.2,  1    },
+};
+
+//Specify the links and initial tuning parameters
+PID myPID(&Input, &Output, &Setpoint, 1, 0.05, 0.25, DIRECT);
+PIDGainSchedule schedule(&myPID, gains, 3, &Gap);
+
+void setup()
+{
+  //initialize the variables we're linked to
+  Input = analogRead(PIN_INPUT);
+  Setpoint = 100;
+
+  //turn the PID on
+  myPID.SetMode(AUTOMATIC);
+}
+
+void loop()
+{
+  Input = analogRead(PIN_INPUT);
+
+  Gap = abs(Setpoint-Input); //distance away from setpoint
+  schedule.Update();
+
+  myPID.Compute();
+  analogWrite(PIN_OUTPUT, Output);
+}
@@ -12,9 +12,17 @@
  * size.  lastly, we add some logic that translates the PID
  * output into "Relay On Time" with the remainder of the
  * window being "Relay Off Time"
+ *
+ *   PIDTimeProportioning does that last part, for one
+ * relay here, or for a whole array of Outputs.  pulses
+ * under 100mS are skipped to spare the relay, and the
+ * output is kept from swinging by more than half the
+ * window per second (with PID_OUTPUT_RATE_LIMIT defined,
+ * see the top of PID_v1.h).
  ********************************************************/
 
 #include <PID_v1.h>
+#include <PID_Relay.h>
 
 #define PIN_INPUT 0
 #define RELAY_PIN 6
@@ -27,17 +35,22 @@ double Kp=2, Ki=5, Kd=1;
 PID myPID(&Input, &Output, &Setpoint, Kp, Ki, Kd, DIRECT);
 
 int WindowSize = 5000;
-unsigned long windowStartTime;
+const uint8_t relayPins[1] = { RELAY_PIN };
+PIDTimeProportioning<1> relay(&Output, relayPins, WindowSize, WindowSize);
 
 void setup()
 {
-  windowStartTime = millis();
-
   //initialize the variables we're linked to
   Setpoint = 100;
 
   //tell the PID to range between 0 and the full window size
   myPID.SetOutputLimits(0, WindowSize);
+#if defined(PID_OUTPUT_RATE_LIMIT)
+  myPID.SetOutputRateLimit(WindowSize / 2);
+#endif
+
+  relay.SetMinPulse(100);
+  relay.Begin();
 
   //turn the PID on
   myPID.SetMode(AUTOMATIC);
@@ -48,17 +61,6 @@ void loop()
   Input = analogRead(PIN_INPUT);
   myPID.Compute();
 
-  /************************************************
-   * turn the output pin on/off based on pid output
-   ************************************************/
-  if (millis() - windowStartTime > WindowSize)
-  { //time to shift the Relay Window
-    windowStartTime += WindowSize;
-  }
-  if (Output < millis() - windowStartTime) digitalWrite(RELAY_PIN, HIGH);
-  else digitalWrite(RELAY_PIN, LOW);
-
+  //turn the output pin on/off based on pid output
+  relay.Update();
 }
-
-
-
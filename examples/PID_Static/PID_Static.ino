@@ -0,0 +1,37 @@
+/********************************************************
+ * PID Static Example
+ * Same as the basic example, but with all the settings
+ * fixed at compile time.  the controller then only needs
+ * RAM for its state and the calculation is reduced to a
+ * few multiply-adds, which helps on small chips like the
+ * ATtiny.
+ ********************************************************/
+
+#include <PID_Static.h>
+
+#define PIN_INPUT 0
+#define PIN_OUTPUT 3
+
+//tunings, sample time etc., everything not listed keeps the default from StaticPIDConfig
+struct MyLoop : StaticPIDConfig
+{
+  static constexpr double Kp = 2, Ki = 5, Kd = 1;
+  static constexpr unsigned long SampleTimeUs = 100000;
+};
+
+StaticPID<MyLoop> myPID;
+
+float Setpoint = 100;
+
+void setup()
+{
+  //start from the current input and output, like SetMode(AUTOMATIC)
+  myPID.Initialize(analogRead(PIN_INPUT), 0);
+}
+
+void loop()
+{
+  float Input = analogRead(PIN_INPUT);
+  if (myPID.Compute(Input, Setpoint))
+    analogWrite(PIN_OUTPUT, myPID.GetOutput());
+}
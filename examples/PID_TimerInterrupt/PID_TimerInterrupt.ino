@@ -0,0 +1,51 @@
+/********************************************************
+ * PID Timer Interrupt Example
+ * Same as the basic example, except that the PID is
+ * computed from a Timer1 interrupt at exactly 1kHz
+ * instead of being polled from loop().  (ATmega only)
+ *
+ *   everything shared with the interrupt is only
+ * touched inside a PIDInterruptLock.
+ ********************************************************/
+
+#include <PID_v1.h>
+#include <PID_Timer.h>
+
+#define PIN_INPUT 0
+#define PIN_OUTPUT 3
+
+//Define Variables we'll be connecting to
+double Setpoint, Input, Output;
+
+//Specify the links and initial tuning parameters
+double Kp=2, Ki=5, Kd=1;
+PID myPID(&Input, &Output, &Setpoint, Kp, Ki, Kd, DIRECT);
+
+//calls myPID.ComputeNow() on every Timer1 compare match
+PID_TIMER1_ISR(myPID)
+
+void setup()
+{
+  //initialize the variables we're linked to
+  Input = analogRead(PIN_INPUT);
+  Setpoint = 100;
+
+  //the sample time still scales the I and D gains, so it has to match the timer
+  myPID.SetSampleTimeUs(1000);
+
+  //turn the PID on and start the timer
+  myPID.SetMode(AUTOMATIC);
+  PIDTimer1Begin(1000);
+}
+
+void loop()
+{
+  double raw = analogRead(PIN_INPUT);
+  double out;
+  {
+    PIDInterruptLock lock;
+    Input = raw;
+    out = Output;
+  }
+  analogWrite(PIN_OUTPUT, out);
+}
@@ -0,0 +1,57 @@
+/********************************************************
+ * PID Warm Restart Example
+ * Saves the controller state to EEPROM every 10 minutes, and
+ * after a reset (watchdog, power cycle, new firmware with
+ * the same state version) carries on from the last saved
+ * state instead of starting over: the integrator, the
+ * filtered input and the output pick up where they were.
+ * The saves rotate over 16 copies (864 of the 1024 bytes of
+ * an Uno's EEPROM), and a save is skipped while nothing
+ * moved by more than SAVE_TOLERANCE. Each cell is rated
+ * for about 100000 writes, that lasts at least 30 years.
+ ********************************************************/
+
+#include <EEPROM.h>
+#include <PID_v1.h>
+#include <PID_State.h>
+
+#define PIN_INPUT 0
+#define PIN_OUTPUT 3
+#define SAVE_INTERVAL 600000UL
+#define SAVE_TOLERANCE 0.5
+#define STATE_SLOTS 16
+
+//Define Variables we'll be connecting to
+double Setpoint, Input, Output;
+
+//Specify the links and initial tuning parameters
+double Kp=2, Ki=5, Kd=1;
+PID myPID(&Input, &Output, &Setpoint, Kp, Ki, Kd, DIRECT);
+
+PIDEEPROMStorage eeprom;
+PIDStateStore<PIDEEPROMStorage, STATE_SLOTS> store(eeprom, 0);
+unsigned long lastSave;
+
+void setup()
+{
+  //initialize the variables we're linked to
+  Input = analogRead(PIN_INPUT);
+  Setpoint = 100;
+
+  //warm start if there is a saved state, otherwise turn the PID on as usual
+  if (!store.Restore(myPID)) myPID.SetMode(AUTOMATIC);
+  lastSave = millis();
+}
+
+void loop()
+{
+  Input = analogRead(PIN_INPUT);
+  myPID.Compute();
+  analogWrite(PIN_OUTPUT, Output);
+
+  if (millis() - lastSave >= SAVE_INTERVAL)
+  {
+    store.Save(myPID, SAVE_TOLERANCE);
+    lastSave = millis();
+  }
+}
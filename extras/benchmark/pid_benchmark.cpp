@@ -0,0 +1,257 @@
+/**********************************************************************************
+ * Host benchmarks for the PID library
+ *
+ *    measures the time per Compute() call for the different controller
+ *  configurations.  every controller runs on a simulated clock that advances
+ *  by one sample time per call, so each Compute() does a full update (except in
+ *  the "skipped" case, where the clock stands still).  the input is a small
+ *  deterministic signal, so the work done doesn't depend on the run.
+ *
+ *  usage: pid_benchmark [filter]     only runs benchmarks whose name contains filter
+ *
+ *  self-contained on purpose (no Google Benchmark dependency), but it reports the
+ *  same way: each benchmark is repeated until it ran for at least MinTime.
+ **********************************************************************************/
+
+#include <Arduino.h>
+#include <PID_v1.h>
+#include <PID_Bank.h>
+#include <PID_Filters.h>
+#include <PID_Scheduler.h>
+
+#include <chrono>
+#include <stdio.h>
+#include <string.h>
+#include <vector>
+
+namespace {
+
+const double MinTime = 0.25;           // seconds per benchmark
+const unsigned long SampleTimeUs = 1000;
+
+unsigned long simulatedTime = 0;
+unsigned long SteppingClock() { return simulatedTime += SampleTimeUs; }
+unsigned long StoppedClock() { return simulatedTime; }
+
+template<class T> inline void DoNotOptimize(T &value)
+{
+#if defined(__GNUC__)
+  asm volatile("" : "+m"(value) : : "memory");
+#else
+  volatile T sink = value; (void)sink;
+#endif
+}
+
+struct Benchmark
+{
+  const char *name;
+  unsigned long itemsPerCall;           // controllers updated per call
+  double (*run)(unsigned long iterations);   // returns elapsed seconds
+};
+
+std::vector<Benchmark> &Registry()
+{
+  static std::vector<Benchmark> benchmarks;
+  return benchmarks;
+}
+
+struct Register
+{
+  Register(const char *name, unsigned long items, double (*run)(unsigned long))
+  {
+    Benchmark b = { name, items, run };
+    Registry().push_back(b);
+  }
+};
+
+double Seconds(std::chrono::steady_clock::time_point start)
+{
+  return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+//test signal, about 1000 samples long so it stays in the cache
+double Signal(unsigned long i) { return 50 + ((i * 7919) % 1000) * 0.01; }
+
+/* single controller ************************************************************/
+template<class Scalar>
+double RunPID(unsigned long iterations, int pOn, double alpha, unsigned long (*clock)(),
+              PIDInputFilter<Scalar> *filter = 0, int form = PID_POSITIONAL)
+{
+  Scalar input = 50, output = 0, setpoint = 55;
+  BasicPID<Scalar> pid(&input, &output, &setpoint, 2, 5, 1, pOn, DIRECT);
+  pid.SetSampleTimeUs(SampleTimeUs);
+  pid.SetSmoothingFactor(alpha);
+  pid.SetInputFilter(filter);
+  pid.SetOutputForm(form);
+  pid.SetTimeSource(clock);
+  pid.SetMode(AUTOMATIC);
+
+  std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+  for (unsigned long i = 0; i < iterations; i++)
+  {
+    input = Signal(i);
+    pid.Compute();
+    DoNotOptimize(output);
+  }
+  return Seconds(start);
+}
+
+template<class Scalar>
+double RunPIDBiquad(unsigned long iterations)
+{
+  PIDBiquad<Scalar> filter;
+  filter.SetLowPass(50, 1000);
+  return RunPID<Scalar>(iterations, P_ON_E, 0, SteppingClock, &filter);
+}
+
+template<class Scalar>
+double RunPIDMedian(unsigned long iterations)
+{
+  PIDMedian<5, Scalar> filter;
+  return RunPID<Scalar>(iterations, P_ON_E, 0, SteppingClock, &filter);
+}
+
+/* value based Compute(input, setpoint, now) **************************************/
+template<class Scalar>
+double RunPIDValue(unsigned long iterations)
+{
+  BasicPID<Scalar> pid(2, 5, 1, P_ON_E, DIRECT);
+  pid.SetSampleTimeUs(SampleTimeUs);
+  pid.SetMode(AUTOMATIC, 50, 0);
+  Scalar output = 0;
+  unsigned long now = 0;
+
+  std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+  for (unsigned long i = 0; i < iterations; i++)
+  {
+    output = pid.Compute(Signal(i), 55, now += SampleTimeUs);
+    DoNotOptimize(output);
+  }
+  return Seconds(start);
+}
+
+/* deadband, sitting at the setpoint **********************************************/
+template<class Scalar>
+double RunPIDDeadband(unsigned long iterations, double band)
+{
+  BasicPID<Scalar> pid(2, 5, 1, P_ON_E, DIRECT);
+  pid.SetSampleTimeUs(SampleTimeUs);
+  pid.SetDeadband(band, band);
+  pid.SetMode(AUTOMATIC, 55, 0);
+  Scalar output = 0;
+  unsigned long now = 0;
+
+  std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+  for (unsigned long i = 0; i < iterations; i++)
+  {
+    output = pid.Compute(55 + (i % 3) * 0.01, 55, now += SampleTimeUs);
+    DoNotOptimize(output);
+  }
+  return Seconds(start);
+}
+
+/* bank of controllers ***********************************************************/
+template<unsigned int N, class Scalar>
+double RunBank(unsigned long iterations)
+{
+  static Scalar input[N], output[N], setpoint[N];
+  PIDBank<N, Scalar> bank(input, output, setpoint);
+  bank.SetSampleTimeUs(SampleTimeUs);
+  bank.SetTimeSource(SteppingClock);
+  for (unsigned int c = 0; c < N; c++)
+  {
+    input[c] = 50; output[c] = 0; setpoint[c] = 55;
+    bank.SetTunings(c, 2, 5, 1, c % 2 ? P_ON_M : P_ON_E);
+    bank.SetMode(c, AUTOMATIC);
+  }
+
+  std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+  for (unsigned long i = 0; i < iterations; i++)
+  {
+    for (unsigned int c = 0; c < N; c++) input[c] = Signal(i + c);
+    bank.Compute();
+    DoNotOptimize(output);
+  }
+  return Seconds(start);
+}
+
+/* many controllers, one loop() pass per call ***************************************
+ * the clock advances by a tenth of the shortest sample time per pass, and the
+ * controllers run at 1 to 8 times that sample time, so most passes find few due
+ **********************************************************************************/
+template<unsigned int N>
+double RunLoopPasses(unsigned long iterations, bool scheduled)
+{
+  static double input[N], output[N], setpoint[N];
+  static PID *pids[N];
+  PIDScheduler<N> scheduler;
+  scheduler.SetTimeSource(StoppedClock);
+  for (unsigned int c = 0; c < N; c++)
+  {
+    input[c] = 50; output[c] = 0; setpoint[c] = 55;
+    if (!pids[c]) pids[c] = new PID(&input[c], &output[c], &setpoint[c], 2, 5, 1, DIRECT);
+    pids[c]->SetSampleTimeUs(SampleTimeUs * (1 + c % 8));
+    pids[c]->SetTimeSource(StoppedClock);
+    pids[c]->SetMode(AUTOMATIC);
+    scheduler.Add(pids[c]);
+  }
+
+  std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+  for (unsigned long i = 0; i < iterations; i++)
+  {
+    simulatedTime += SampleTimeUs / 10;
+    if (scheduled) scheduler.Run();
+    else for (unsigned int c = 0; c < N; c++) pids[c]->Compute();
+    DoNotOptimize(output);
+  }
+  return Seconds(start);
+}
+
+#define PID_BENCHMARK(name, items, expr) \
+  double name(unsigned long n) { return expr; } \
+  Register register_##name(#name, items, name);
+
+PID_BENCHMARK(PID_double_PonE_filtered,   1, RunPID<double>(n, P_ON_E, 0.9, SteppingClock))
+PID_BENCHMARK(PID_double_PonE_unfiltered, 1, RunPID<double>(n, P_ON_E, 0.0, SteppingClock))
+PID_BENCHMARK(PID_double_PonM,            1, RunPID<double>(n, P_ON_M, 0.9, SteppingClock))
+PID_BENCHMARK(PID_double_velocity,        1, RunPID<double>(n, P_ON_E, 0.9, SteppingClock, 0, PID_VELOCITY))
+PID_BENCHMARK(PID_double_PonE_biquad,     1, RunPIDBiquad<double>(n))
+PID_BENCHMARK(PID_double_PonE_median5,    1, RunPIDMedian<double>(n))
+PID_BENCHMARK(PID_float_PonE_filtered,    1, RunPID<float>(n, P_ON_E, 0.9, SteppingClock))
+PID_BENCHMARK(PID_float_PonM,             1, RunPID<float>(n, P_ON_M, 0.9, SteppingClock))
+PID_BENCHMARK(PID_Q16_PonE_filtered,      1, RunPID<PIDQ16_16>(n, P_ON_E, 0.9, SteppingClock))
+PID_BENCHMARK(PID_Q16_PonM,               1, RunPID<PIDQ16_16>(n, P_ON_M, 0.9, SteppingClock))
+PID_BENCHMARK(PID_Q16_velocity,           1, RunPID<PIDQ16_16>(n, P_ON_E, 0.9, SteppingClock, 0, PID_VELOCITY))
+PID_BENCHMARK(PID_double_value,           1, RunPIDValue<double>(n))
+PID_BENCHMARK(PID_double_at_setpoint,      1, RunPIDDeadband<double>(n, 0))
+PID_BENCHMARK(PID_double_deadband_idle,   1, RunPIDDeadband<double>(n, 0.5))
+PID_BENCHMARK(PID_double_skipped,         1, RunPID<double>(n, P_ON_E, 0.9, StoppedClock))
+PID_BENCHMARK(Loop32_Compute,            32, RunLoopPasses<32>(n, false))
+PID_BENCHMARK(Loop32_Scheduler,          32, RunLoopPasses<32>(n, true))
+PID_BENCHMARK(Bank64_double,             64, (RunBank<64, double>(n)))
+PID_BENCHMARK(Bank64_float,              64, (RunBank<64, float>(n)))
+
+} // namespace
+
+int main(int argc, char **argv)
+{
+  const char *filter = argc > 1 ? argv[1] : "";
+  printf("%-30s %14s %12s %16s\n", "Benchmark", "Iterations", "ns/call", "ns/controller");
+  for (size_t b = 0; b < Registry().size(); b++)
+  {
+    const Benchmark &bench = Registry()[b];
+    if (!strstr(bench.name, filter)) continue;
+
+    unsigned long iterations = 1000;
+    double elapsed = bench.run(iterations);
+    while (elapsed < MinTime)
+    {
+      double factor = elapsed > 0 ? 1.4 * MinTime / elapsed : 10;
+      iterations = (unsigned long)(iterations * (factor > 10 ? 10 : factor)) + 1;
+      elapsed = bench.run(iterations);
+    }
+    double ns = elapsed * 1e9 / iterations;
+    printf("%-30s %14lu %12.2f %16.2f\n", bench.name, iterations, ns, ns / bench.itemsPerCall);
+  }
+  return 0;
+}
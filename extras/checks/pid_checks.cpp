@@ -0,0 +1,374 @@
+/**********************************************************************************
+ * Host checks of controller behaviour that is easy to break
+ *
+ *    each check sets up a PID on a simulated clock, drives it through one
+ *  situation and compares the outcome with what the library promises.  run by
+ *  ctest, or directly: prints every failing check and exits with 1 if any did.
+ *  built twice, as pid_checks with all the optional features of PID_v1.h and
+ *  as pid_checks_plain without them; a feature's checks only run where it is.
+ *
+ *  usage: pid_checks
+ **********************************************************************************/
+
+#include <Arduino.h>
+#include <PID_v1.h>
+#include <PID_State.h>
+
+#include <math.h>
+#include <stdio.h>
+
+namespace {
+
+int failures = 0;
+unsigned long simTime = 0;
+
+unsigned long SimMicros() { return simTime; }
+
+void Expect(bool ok, const char *check, const char *what, double value)
+{
+  if (ok) return;
+  printf("FAIL %s: %s (%g)\n", check, what, value);
+  failures++;
+}
+
+#if defined(PID_TIMING_MODES)
+/* MeasuredDtCatchUp() ************************************************************
+ *     PID_MEASURED_DT with PID_OVERRUN_CATCH_UP: after a stall of three periods
+ *   the samples that catch up run at the same time as the late one.  they must
+ *   not take D from a dt of 0 (that drove the output to a rail), and the I sum
+ *   has to grow by the elapsed time only
+ **********************************************************************************/
+void MeasuredDtCatchUp()
+{
+  const char *name = "measured dt + catch up";
+  PID pid(1, 1, 1, P_ON_E, DIRECT);
+  pid.SetSampleTime(10);
+  pid.SetOutputLimits(-1000, 1000);
+  pid.SetIntegratorLimits(-1000, 1000);
+  pid.SetSmoothingFactor(0);
+  pid.SetTimingMode(PID_MEASURED_DT);
+  pid.SetOverrunPolicy(PID_OVERRUN_CATCH_UP);
+  pid.SetMode(AUTOMATIC, 0, 0);
+
+  unsigned long now = 0;
+  double input = 0, output = 0;
+  for (int i = 0; i < 10; i++)
+  {
+    now += 10000;
+    input += 0.1;
+    output = pid.Compute(input, 5, now);
+  }
+
+  //stalled for 3.2 periods, the input kept ramping at the same rate
+  now += 32000;
+  input += 0.32;
+  double before = pid.GetLastIPart();
+  double late = pid.Compute(input, 5, now);
+  Expect(fabs(late - output) < 1, name, "late sample: output jumped", late - output);
+  double iLate = pid.GetLastIPart();
+  Expect(fabs(iLate - before - 0.032 * (5 - input)) < 1e-9, name, "late sample: I sum isn't ki*e*dt",
+         iLate - before);
+  for (int k = 0; k < 3; k++)
+  {
+    double o = pid.Compute(input, 5, now);
+    Expect(isfinite(o) && o == late, name, "catch-up sample at the same time changed the output", o);
+  }
+  Expect(pid.GetLastIPart() == iLate, name, "catch-up samples at the same time changed the I sum",
+         pid.GetLastIPart() - iLate);
+}
+#endif
+
+#if defined(PID_SETPOINT_WEIGHTS)
+/* SetpointWeightTransfer() *******************************************************
+ *     lowering b in AUTOMATIC moves kp*(b - b')*Setpoint into the I sum.  with a
+ *   setpoint of 200 and Kp 2 that is more than the 0..255 the I sum may hold,
+ *   the output must still not move, and raising b again must not either
+ **********************************************************************************/
+void SetpointWeightTransfer()
+{
+  const char *name = "setpoint weight transfer";
+  double input = 190, output = 104, setpoint = 200;
+  double refInput = 190, refOutput = 104, refSetpoint = 200;
+  PID pid(&input, &output, &setpoint, 2, 0.5, 0, P_ON_E, DIRECT);
+  PID ref(&refInput, &refOutput, &refSetpoint, 2, 0.5, 0, P_ON_E, DIRECT);
+  PID *both[] = { &pid, &ref };
+  for (int k = 0; k < 2; k++)
+  {
+    both[k]->SetTimeSource(SimMicros);
+    both[k]->SetSmoothingFactor(0);
+    both[k]->SetMode(AUTOMATIC);
+  }
+  simTime = 0;
+  for (int i = 0; i < 3; i++)
+  {
+    simTime += 100000;
+    pid.Compute();
+    ref.Compute();
+  }
+
+  double weights[] = { 0.25, 1 };
+  for (int w = 0; w < 2; w++)
+  {
+    pid.SetSetpointWeights(weights[w], 0);
+    simTime += 100000;
+    pid.Compute();
+    ref.Compute();
+    Expect(fabs(output - refOutput) < 1e-9, name, weights[w] < 1 ? "output moved when b was lowered"
+           : "output moved when b was raised again", output - refOutput);
+  }
+}
+#endif
+
+#if defined(PID_SETPOINT_WEIGHTS)
+/* RestoreWithSetpointWeight() ****************************************************
+ *     a PIDState restored into a fresh PID must carry on like the one it was
+ *   saved from, also with c > 0 where a stale last setpoint is a derivative kick
+ **********************************************************************************/
+void RestoreWithSetpointWeight()
+{
+  const char *name = "restore with c > 0";
+  double input = 150, output = 50, setpoint = 200;
+  PID pid(&input, &output, &setpoint, 2, 0.5, 1, P_ON_E, DIRECT);
+  pid.SetTimeSource(SimMicros);
+  pid.SetOutputLimits(-1000, 1000);
+  pid.SetSetpointWeights(1, 0.5);
+  pid.SetMode(AUTOMATIC);
+  simTime = 0;
+  for (int i = 0; i < 5; i++)
+  {
+    simTime += 100000;
+    input += 0.5;
+    pid.Compute();
+  }
+
+  PIDState state;
+  pid.SaveState(state);
+  double restoredOutput = 0;
+  PID restored(&input, &restoredOutput, &setpoint, 1, 0, 0, P_ON_E, DIRECT);
+  restored.SetTimeSource(SimMicros);
+  restored.SetSetpointWeights(1, 0.5);
+  Expect(restored.RestoreState(state), name, "state not accepted", 0);
+
+  simTime += 100000;
+  input += 0.5;
+  pid.Compute();
+  restored.Compute();
+  Expect(fabs(restoredOutput - output) < 1e-3, name, "first sample after the restore differs",
+         restoredOutput - output);
+}
+#endif
+
+#if defined(PID_VELOCITY_FORM)
+/* VelocityDefaultLimits() ********************************************************
+ *     in PID_VELOCITY form the default 0..255 output limits are the actuator
+ *   range, an input above the setpoint still has to give a negative change
+ **********************************************************************************/
+void VelocityDefaultLimits()
+{
+  const char *name = "velocity form, default limits";
+  double input = 100, output = 0, setpoint = 100;
+  PID pid(&input, &output, &setpoint, 2, 0.5, 0, P_ON_E, DIRECT);
+  pid.SetTimeSource(SimMicros);
+  pid.SetOutputForm(PID_VELOCITY);
+  pid.SetMode(AUTOMATIC);
+  simTime = 100000;
+  input = 120;
+  pid.Compute();
+  Expect(output < 0, name, "input above the setpoint didn't lower the output", output);
+  simTime += 100000;
+  setpoint = 500;
+  pid.Compute();
+  Expect(output == 255, name, "change not limited to the width of the output range", output);
+}
+#endif
+
+#if defined(PID_VELOCITY_FORM)
+/* VelocityWarmRestart() **********************************************************
+ *     a PID_VELOCITY loop restored from its PIDState gives the same change on
+ *   the next sample as the loop it was saved from, no P or feed-forward kick.
+ *   the D part starts over from 0 as in Initialize(), so it is saved settled
+ **********************************************************************************/
+void VelocityWarmRestart()
+{
+  const char *name = "velocity warm restart";
+  double input = 40, output = 0, setpoint = 60;
+  PID pid(&input, &output, &setpoint, 2, 0.5, 0.2, P_ON_E, DIRECT);
+  pid.SetTimeSource(SimMicros);
+  pid.SetOutputLimits(-50, 50);
+  pid.SetSmoothingFactor(0);
+  pid.SetOutputForm(PID_VELOCITY);
+  pid.SetMode(AUTOMATIC);
+  simTime = 0;
+  for (int i = 0; i < 5; i++)
+  {
+    simTime += 100000;
+    if (i < 4) input += 1;             //the last sample before the save settles the D part
+    pid.Compute();
+  }
+
+  PIDState state;
+  pid.SaveState(state);
+  double restoredOutput = 0;
+  PID restored(&input, &restoredOutput, &setpoint, 1, 0, 0, P_ON_E, DIRECT);
+  restored.SetTimeSource(SimMicros);
+  restored.SetSmoothingFactor(0);
+  restored.SetOutputForm(PID_VELOCITY);
+  Expect(restored.RestoreState(state), name, "state not accepted", 0);
+
+  simTime += 100000;
+  input += 1;
+  pid.Compute();
+  restored.Compute();
+  Expect(fabs(restoredOutput - output) < 1e-3, name, "first change after the restore differs",
+         restoredOutput - output);
+}
+#endif
+
+#if defined(PID_FEED_FORWARD)
+/* FeedForwardSteadyState() *******************************************************
+ *     a feed-forward larger than the output the process needs (30 where 20
+ *   holds the setpoint) has to be taken back by a negative I sum, so the loop
+ *   still settles on the setpoint.  the plant is y' = (u - y)/1s
+ **********************************************************************************/
+void FeedForwardSteadyState()
+{
+  const char *name = "large feed-forward";
+  double input = 0, output = 0, setpoint = 20, disturbance = 30;
+  PID pid(&input, &output, &setpoint, 1, 0.5, 0, P_ON_E, DIRECT);
+  pid.SetTimeSource(SimMicros);
+  pid.SetSmoothingFactor(0);
+  pid.SetFeedForward(&disturbance, 1);
+  pid.SetMode(AUTOMATIC);
+  simTime = 0;
+  for (int i = 0; i < 1200; i++)
+  {
+    simTime += 100000;
+    pid.Compute();
+    input += 0.1 * (output - input);
+  }
+  Expect(fabs(input - 20) < 0.01, name, "didn't settle on the setpoint", input);
+  Expect(fabs(pid.GetLastIPart() + 10) < 0.01, name, "I sum doesn't take back the feed-forward",
+         pid.GetLastIPart());
+}
+#endif
+
+#if defined(PID_FEED_FORWARD)
+/* FeedForwardSwitchOn() **********************************************************
+ *     switching the feed-forward on in AUTOMATIC moves it out of the I sum, so
+ *   the output stays where it was, also when that makes the I sum negative
+ **********************************************************************************/
+void FeedForwardSwitchOn()
+{
+  const char *name = "feed-forward switched on";
+  double input = 0, output = 0, setpoint = 20, disturbance = 50;
+  PID pid(&input, &output, &setpoint, 1, 0.5, 0, P_ON_E, DIRECT);
+  pid.SetTimeSource(SimMicros);
+  pid.SetSmoothingFactor(0);
+  pid.SetMode(AUTOMATIC);
+  simTime = 0;
+  for (int i = 0; i < 1200; i++)
+  {
+    simTime += 100000;
+    pid.Compute();
+    input += 0.1 * (output - input);
+  }
+  double before = output;
+  pid.SetFeedForward(&disturbance, 1);
+  simTime += 100000;
+  pid.Compute();
+  Expect(fabs(output - before) < 0.01, name, "output jumped", output - before);
+  Expect(pid.GetFeedForward() == 50, name, "feed-forward not in the output", pid.GetFeedForward());
+}
+#endif
+
+#if defined(PID_VELOCITY_FORM)
+/* VelocityManual() ***************************************************************
+ *     in MANUAL a PID_VELOCITY controller asks for no change: the value based
+ *   Compute() and ComputeNow() both return 0, not the last change, which a
+ *   caller adding it to the actuator (like PIDCascade) would keep applying
+ **********************************************************************************/
+void VelocityManual()
+{
+  const char *name = "velocity form in MANUAL";
+  PID pid(2, 0.5, 0, P_ON_E, DIRECT);
+  pid.SetSampleTime(100);
+  pid.SetOutputLimits(-50, 50);
+  pid.SetOutputForm(PID_VELOCITY);
+  pid.SetMode(AUTOMATIC, 0, 0);
+  double delta = pid.ComputeNow(0, 10);
+  Expect(delta != 0, name, "no change to begin with", delta);
+  pid.SetMode(MANUAL);
+  delta = pid.ComputeNow(0, 10);
+  Expect(delta == 0, name, "ComputeNow() repeats the last change", delta);
+  delta = pid.Compute(0, 10, 1000000);
+  Expect(delta == 0, name, "Compute() repeats the last change", delta);
+}
+#endif
+
+#if defined(PID_TIMING_MODES)
+/* CatchUpLongSampleTime() ********************************************************
+ *     the stall limit is MaxLate sample times.  with a sample time of a third of
+ *   the clock range, 4 periods don't fit in an unsigned long: the limit has to
+ *   stay at the largest time instead of wrapping to about one period, or a
+ *   sample half a period late would count as a stall and drop the catch-up
+ **********************************************************************************/
+void CatchUpLongSampleTime()
+{
+  const char *name = "catch up, long sample time";
+  const unsigned long period = ~0UL / 3;
+  double input = 0, output = 0, setpoint = 1;
+  PID pid(&input, &output, &setpoint, 1, 0.1, 0, P_ON_E, DIRECT);
+  pid.SetSampleTimeUs(period);
+  pid.SetOverrunPolicy(PID_OVERRUN_CATCH_UP);
+  simTime = 0;
+  pid.SetTimeSource(SimMicros);
+  pid.SetMode(AUTOMATIC);
+  Expect(pid.Compute(), name, "first sample not computed", 0);
+  simTime = period + period / 2;
+  Expect(pid.Compute(), name, "late sample not computed", 0);
+  simTime = 2 * period + 1;
+  Expect(pid.Compute(), name, "next sample not kept on the grid", double(simTime));
+}
+#endif
+
+/* Q24DefaultLimits() *************************************************************
+ *     Q8.24 only reaches +-128, so a PIDQ24 can't have the usual 0..255 output
+ *   limits: the default upper limit must be one its output can actually reach
+ **********************************************************************************/
+void Q24DefaultLimits()
+{
+  const char *name = "PIDQ24 default limits";
+  PIDQ24 pid(1, 0, 0, P_ON_E, DIRECT);
+  pid.SetMode(AUTOMATIC, PIDQ8_24(0), PIDQ8_24(0));
+  double max = double(pid.GetOutputMax());
+  double output = double(pid.ComputeNow(PIDQ8_24(0), PIDQ8_24(120)));
+  Expect(max < 128, name, "upper limit outside the Q8.24 range", max);
+  Expect(output == max && pid.IsSaturated(), name, "output doesn't reach the upper limit", output);
+}
+
+} // namespace
+
+int main()
+{
+#if defined(PID_TIMING_MODES)
+  MeasuredDtCatchUp();
+  CatchUpLongSampleTime();
+#endif
+#if defined(PID_SETPOINT_WEIGHTS)
+  SetpointWeightTransfer();
+  RestoreWithSetpointWeight();
+#endif
+#if defined(PID_VELOCITY_FORM)
+  VelocityDefaultLimits();
+  VelocityWarmRestart();
+  VelocityManual();
+#endif
+#if defined(PID_FEED_FORWARD)
+  FeedForwardSteadyState();
+  FeedForwardSwitchOn();
+#endif
+  Q24DefaultLimits();
+  if (failures) return 1;
+  printf("all checks passed\n");
+  return 0;
+}
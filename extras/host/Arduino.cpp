@@ -0,0 +1,16 @@
+#include "Arduino.h"
+
+#include <chrono>
+
+static const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+unsigned long micros()
+{
+   return (unsigned long)std::chrono::duration_cast<std::chrono::microseconds>(
+      std::chrono::steady_clock::now() - start).count();
+}
+
+unsigned long millis()
+{
+   return micros() / 1000;
+}
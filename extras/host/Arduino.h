@@ -0,0 +1,37 @@
+#ifndef PID_Host_Arduino_h
+#define PID_Host_Arduino_h
+
+/**********************************************************************************
+ * Minimal stand-in for the Arduino core, so the library compiles on a PC.
+ * only what the library itself uses is provided.  millis() and micros() run
+ * off the host's steady clock; controllers that need a simulated time should
+ * be given one with SetTimeSource() instead.
+ **********************************************************************************/
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+
+unsigned long millis();
+unsigned long micros();
+
+inline void noInterrupts() {}
+inline void interrupts() {}
+
+#define PROGMEM
+#define memcpy_P memcpy
+
+class Print
+{
+public:
+  virtual ~Print() {}
+  virtual size_t write(uint8_t) = 0;
+  virtual size_t write(const uint8_t *buffer, size_t size)
+  {
+     size_t n = 0;
+     while (size--) n += write(*buffer++);
+     return n;
+  }
+};
+
+#endif
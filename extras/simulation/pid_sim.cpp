@@ -0,0 +1,105 @@
+#include "pid_sim.h"
+
+#include <atomic>
+#include <thread>
+
+thread_local unsigned long SimClock::now = 0;
+
+SimPlant SimPlant::FOPDT(double Gain, double Tau, double DeadTime)
+{
+   SimPlant p;
+   p.type = FirstOrder;
+   p.gain = Gain;
+   p.tau = Tau > 0 ? Tau : 1e-9;
+   p.wn = p.zeta = 0;
+   p.deadTime = DeadTime > 0 ? DeadTime : 0;
+   p.Reset(0, 0.001);
+   return p;
+}
+
+SimPlant SimPlant::SOPDT(double Gain, double Wn, double Zeta, double DeadTime)
+{
+   SimPlant p;
+   p.type = SecondOrder;
+   p.gain = Gain;
+   p.tau = 0;
+   p.wn = Wn;
+   p.zeta = Zeta;
+   p.deadTime = DeadTime > 0 ? DeadTime : 0;
+   p.Reset(0, 0.001);
+   return p;
+}
+
+/* Reset(...) ***********************************************************************
+ *     the delay line is filled with the input that holds the output where it is
+ **********************************************************************************/
+void SimPlant::Reset(double Output, double StepSeconds)
+{
+   y = Output;
+   v = 0;
+   dt = StepSeconds;
+   decay = type == FirstOrder ? 1 - exp(-dt / tau) : 0;
+   size_t n = (size_t)(deadTime / dt + 0.5);
+   delay.assign(n, gain != 0 ? Output / gain : 0);
+   head = 0;
+}
+
+double SimPlant::Step(double u)
+{
+   if (!delay.empty())
+   {
+      double delayed = delay[head];
+      delay[head] = u;
+      if (++head == delay.size()) head = 0;
+      u = delayed;
+   }
+
+   if (type == FirstOrder) y += decay * (gain * u - y);
+   else
+   {
+      v += dt * (wn * wn * (gain * u - y) - 2 * zeta * wn * v);
+      y += dt * v;
+   }
+   return y;
+}
+
+LoopSpec::LoopSpec()
+  : plant(SimPlant::FOPDT(1, 10, 1)),
+    kp(1), ki(0.1), kd(0), pOn(P_ON_E), alpha(0),
+    sampleTimeUs(100000), stepUs(10000),
+    outMin(0), outMax(255),
+    start(0), setpoint(50), duration(200),
+    disturbanceAt(100), disturbance(-20),
+    noise(0), seed(0)
+{
+}
+
+/* RunLoops(...) ********************************************************************
+ *     the threads take the next few specs off a shared counter until none are
+ *   left, so a mix of short and long loops still keeps all cores busy.  each
+ *   result is written to its own slot, the order doesn't depend on the threads
+ **********************************************************************************/
+void RunLoops(const std::vector<LoopSpec> &specs, std::vector<LoopMetrics> &results, unsigned int threads)
+{
+   results.resize(specs.size());
+   if (threads == 0) threads = std::thread::hardware_concurrency();
+   if (threads == 0) threads = 1;
+   if (threads > specs.size()) threads = specs.size() ? specs.size() : 1;
+
+   const size_t chunk = 8;
+   std::atomic<size_t> next(0);
+   auto worker = [&]() {
+      for (;;)
+      {
+         size_t first = next.fetch_add(chunk);
+         if (first >= specs.size()) break;
+         size_t last = first + chunk < specs.size() ? first + chunk : specs.size();
+         for (size_t i = first; i < last; i++) results[i] = RunLoop(specs[i]);
+      }
+   };
+
+   std::vector<std::thread> pool;
+   for (unsigned int t = 1; t < threads; t++) pool.push_back(std::thread(worker));
+   worker();
+   for (size_t t = 0; t < pool.size(); t++) pool[t].join();
+}
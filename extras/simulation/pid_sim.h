@@ -0,0 +1,268 @@
+#ifndef PID_Sim_h
+#define PID_Sim_h
+
+/**********************************************************************************
+ * Closed loop simulation on the host
+ *
+ *    runs the library's own PID class against a simulated process, so tunings
+ *  and library changes can be checked without hardware.  the pieces:
+ *
+ *    SimClock      a simulated time, one per thread, for SetTimeSource().  the
+ *                  PID is computed through its normal Compute(), so the timing
+ *                  code is exercised as on the board
+ *    SimPlant      first order plus dead time, or second order plus dead time
+ *    LoopSpec      a plant, tunings, a setpoint step and a load disturbance
+ *    RunLoop()     simulates one loop and returns its LoopMetrics (IAE, ISE,
+ *                  ITAE, overshoot, settling time)
+ *    RunBatch()    simulates up to N loops at once on one PIDBank
+ *    RunLoops()    runs many LoopSpecs on all cores
+ *
+ *  everything is deterministic: the measurement noise comes from a generator
+ *  seeded by the spec, so a loop gives the same metrics on any thread.
+ **********************************************************************************/
+
+#include <Arduino.h>
+#include <PID_v1.h>
+#include <PID_Bank.h>
+
+#include <math.h>
+#include <vector>
+
+/* SimClock *********************************************************************
+ *     thread_local, so loops on different threads each have their own time
+ ********************************************************************************/
+class SimClock
+{
+public:
+  static unsigned long Micros() { return now; }
+  static void Set(unsigned long t) { now = t; }
+  static void Advance(unsigned long dt) { now += dt; }
+
+private:
+  static thread_local unsigned long now;
+};
+
+/* SimPlant *********************************************************************
+ *     K*e^(-theta s)/(tau s + 1), or K*wn^2*e^(-theta s)/(s^2 + 2 zeta wn s + wn^2).
+ *   the first order part is discretized exactly for a held input; the second
+ *   order one with semi-implicit Euler, so keep the step well below 1/wn.
+ *   the dead time is a delay line of whole steps
+ ********************************************************************************/
+class SimPlant
+{
+public:
+  enum Type { FirstOrder, SecondOrder };
+
+  static SimPlant FOPDT(double Gain, double Tau, double DeadTime);
+  static SimPlant SOPDT(double Gain, double Wn, double Zeta, double DeadTime);
+
+  void Reset(double Output, double StepSeconds);  // * in steady state at Output, for this step
+  double Step(double u);                          // * holds u for one step, returns the new output
+  double Output() const { return y; }
+
+  Type type;
+  double gain, tau, wn, zeta, deadTime;
+
+private:
+  double y, v;                          // output and, for second order, its rate
+  double dt, decay;
+  std::vector<double> delay;            // the inputs of the last deadTime/dt steps
+  size_t head;
+};
+
+struct LoopSpec
+{
+  SimPlant plant;
+  double kp, ki, kd;
+  int pOn;                              // P_ON_E or P_ON_M
+  double alpha;                         // SetSmoothingFactor(), the weight of the old value: 0 = unfiltered
+  unsigned long sampleTimeUs;
+  unsigned long stepUs;                 // simulation step, the PID is offered every step
+  double outMin, outMax;
+  double start, setpoint;               // the process settles at start, then the setpoint steps
+  double duration;                      // seconds
+  double disturbanceAt, disturbance;    // load step added to the plant input
+  double noise;                         // peak measurement noise
+  unsigned long seed;
+
+  LoopSpec();
+};
+
+struct LoopMetrics
+{
+  double iae, ise, itae;                // integrals of |e|, e^2 and t|e| over the run
+  double overshoot;                     // in % of the setpoint step
+  double settlingTime;                  // seconds until |e| stays within 2% of the step, before the disturbance
+  double peakDisturbance;               // largest |e| after the disturbance
+  unsigned long computes;               // samples the PID actually computed
+  unsigned long steps;
+};
+
+template<class Scalar> LoopMetrics RunLoop(const LoopSpec&);
+inline LoopMetrics RunLoop(const LoopSpec &spec) { return RunLoop<double>(spec); }
+
+void RunLoops(const std::vector<LoopSpec>&, std::vector<LoopMetrics>&,  // * spread over Threads threads,
+              unsigned int Threads = 0);                               //   0 = one per core
+
+/* LoopRecorder *****************************************************************
+ *     accumulates the LoopMetrics of one loop, a step at a time
+ ********************************************************************************/
+class LoopRecorder
+{
+public:
+  void Begin(const LoopSpec&, double StepSeconds);
+  double Measure(double y);             // * y plus the noise of the spec, for the PID input
+  void Add(double t, double y);         // * records the plant output y at time t
+  LoopMetrics End();
+
+private:
+  const LoopSpec *spec;
+  LoopMetrics m;
+  double dt, stepSize, band, peak;
+  unsigned long random;
+};
+
+inline void LoopRecorder::Begin(const LoopSpec &s, double StepSeconds)
+{
+  spec = &s;
+  m = LoopMetrics();
+  dt = StepSeconds;
+  stepSize = fabs(s.setpoint - s.start);
+  band = 0.02 * (stepSize > 0 ? stepSize : 1);
+  peak = 0;
+  random = s.seed * 2654435761UL + 1;
+}
+
+inline double LoopRecorder::Measure(double y)
+{
+  if (spec->noise <= 0) return y;
+  random = random * 1103515245UL + 12345UL;
+  return y + spec->noise * (((random >> 8) & 0xFFFF) / 32767.5 - 1);
+}
+
+inline void LoopRecorder::Add(double t, double y)
+{
+  double e = spec->setpoint - y;
+  m.iae += fabs(e) * dt;
+  m.ise += e * e * dt;
+  m.itae += t * fabs(e) * dt;
+  if (t < spec->disturbanceAt)
+  {
+    double over = spec->setpoint > spec->start ? y - spec->setpoint : spec->setpoint - y;
+    if (over > peak) peak = over;
+    if (fabs(e) > band) m.settlingTime = t + dt;
+  }
+  else if (fabs(e) > m.peakDisturbance) m.peakDisturbance = fabs(e);
+  m.steps++;
+}
+
+inline LoopMetrics LoopRecorder::End()
+{
+  m.overshoot = stepSize > 0 ? 100 * peak / stepSize : 0;
+  return m;
+}
+
+/* RunLoop<Scalar>(...) *************************************************************
+ *     the PID is set up like a sketch would do it, on the SimClock of this
+ *   thread, and Compute() is called once per simulation step
+ **********************************************************************************/
+template<class Scalar>
+LoopMetrics RunLoop(const LoopSpec &spec)
+{
+  SimPlant plant = spec.plant;
+  double dt = spec.stepUs / 1000000.0;
+  double u0 = plant.gain != 0 ? spec.start / plant.gain : 0;
+  plant.Reset(spec.start, dt);
+
+  Scalar input = spec.start, output = u0, setpoint = spec.setpoint;
+  BasicPID<Scalar> pid(&input, &output, &setpoint, spec.kp, spec.ki, spec.kd, spec.pOn, DIRECT);
+  SimClock::Set(0);
+  pid.SetTimeSource(SimClock::Micros);
+  pid.SetSampleTimeUs(spec.sampleTimeUs);
+  pid.SetOutputLimits(spec.outMin, spec.outMax);
+  pid.SetIntegratorLimits(spec.outMin, spec.outMax);
+  pid.SetSmoothingFactor(spec.alpha);
+  pid.SetMode(AUTOMATIC);
+
+  LoopRecorder recorder;
+  recorder.Begin(spec, dt);
+  unsigned long computes = 0;
+  unsigned long steps = (unsigned long)(spec.duration / dt);
+  for (unsigned long i = 0; i < steps; i++)
+  {
+    double t = i * dt;
+    double y = plant.Output();
+    input = recorder.Measure(y);
+    if (pid.Compute()) computes++;
+    recorder.Add(t, y);
+
+    double load = t >= spec.disturbanceAt ? spec.disturbance : 0;
+    plant.Step(double(output) + load);
+    SimClock::Advance(spec.stepUs);
+  }
+  LoopMetrics m = recorder.End();
+  m.computes = computes;
+  return m;
+}
+
+/* RunBatch<N, Scalar>(...) *********************************************************
+ *     n <= N loops at once, on the channels of one PIDBank, so the controller
+ *   math of all of them is one vectorizable pass per sample.  the loops share
+ *   the bank's clock, so they have to agree on sampleTimeUs, stepUs and
+ *   duration (the first spec's are used); plants, tunings, setpoints and
+ *   disturbances are per loop.  the bank has the math of a default PID
+ *   (PID_AW_HOLD, EWMA input filter), so the results carry over to one
+ **********************************************************************************/
+template<unsigned int N, class Scalar>
+void RunBatch(const LoopSpec *specs, unsigned int n, LoopMetrics *results)
+{
+  if (n > N) n = N;
+  const LoopSpec &first = specs[0];
+  double dt = first.stepUs / 1000000.0;
+  SimPlant plants[N];
+  LoopRecorder recorders[N];
+  Scalar input[N], output[N], setpoint[N];
+
+  PIDBank<N, Scalar> bank(input, output, setpoint);
+  SimClock::Set(0);
+  bank.SetTimeSource(SimClock::Micros);
+  bank.SetSampleTimeUs(first.sampleTimeUs);
+  for (unsigned int c = 0; c < N; c++)
+  {
+    const LoopSpec &s = specs[c < n ? c : 0];
+    plants[c] = s.plant;
+    plants[c].Reset(s.start, dt);
+    recorders[c].Begin(s, dt);
+    input[c] = s.start;
+    output[c] = s.plant.gain != 0 ? s.start / s.plant.gain : 0;
+    setpoint[c] = s.setpoint;
+    bank.SetOutputLimits(c, s.outMin, s.outMax);
+    bank.SetIntegratorLimits(c, s.outMin, s.outMax);
+    bank.SetTunings(c, s.kp, s.ki, s.kd, s.pOn);
+    bank.SetSmoothingFactor(c, s.alpha);
+    if (c < n) bank.SetMode(c, AUTOMATIC);
+  }
+
+  unsigned long computes = 0;
+  unsigned long steps = (unsigned long)(first.duration / dt);
+  for (unsigned long i = 0; i < steps; i++)
+  {
+    double t = i * dt;
+    for (unsigned int c = 0; c < n; c++) input[c] = recorders[c].Measure(plants[c].Output());
+    if (bank.Compute()) computes++;
+    for (unsigned int c = 0; c < n; c++)
+    {
+      recorders[c].Add(t, plants[c].Output());
+      double load = t >= specs[c].disturbanceAt ? specs[c].disturbance : 0;
+      plants[c].Step(double(output[c]) + load);
+    }
+    SimClock::Advance(first.stepUs);
+  }
+  for (unsigned int c = 0; c < n; c++)
+  {
+    results[c] = recorders[c].End();
+    results[c].computes = computes;
+  }
+}
+
+#endif
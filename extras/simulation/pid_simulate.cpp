@@ -0,0 +1,233 @@
+/**********************************************************************************
+ * Closed loop simulation runner
+ *
+ *    simulates a grid of loops (four plants, a range of tunings around a SIMC
+ *  starting point, P_ON_E and P_ON_M, with and without measurement noise) on
+ *  all cores, and prints the best tuning per plant with its metrics, and the
+ *  throughput.
+ *
+ *  usage: pid_simulate [--loops N] [--threads N] [--csv FILE] [--check FILE]
+ *
+ *    --loops N      how many loops to simulate (default: the grid once).  past
+ *                   the size of the grid it starts over with new noise seeds
+ *    --threads N    worker threads, default one per core
+ *    --csv FILE     writes the metrics of every loop to FILE
+ *    --check FILE   compares the metrics with a FILE written by --csv earlier,
+ *                   for regression tests of library changes.  exits with 1 if
+ *                   any loop differs
+ **********************************************************************************/
+
+#include "pid_sim.h"
+
+#include <chrono>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <thread>
+
+namespace {
+
+struct PlantCase
+{
+  const char *name;
+  SimPlant plant;
+  double tau, theta, td;                // FOPDT approximation for the SIMC rule, and a Td
+};
+
+std::vector<PlantCase> Plants()
+{
+  std::vector<PlantCase> plants;
+  PlantCase fast = { "fopdt lag", SimPlant::FOPDT(2, 5, 0.5), 5, 0.5, 0 };
+  PlantCase dead = { "fopdt dead time", SimPlant::FOPDT(1, 20, 8), 20, 8, 0 };
+  //half rule: the smaller time constant goes half into the dead time, half into Td
+  PlantCase over = { "sopdt overdamped", SimPlant::SOPDT(1.5, 0.2, 1.5, 1), 14.6, 1.9, 1.7 };
+  PlantCase under = { "sopdt underdamped", SimPlant::SOPDT(1, 0.5, 0.3, 0.2), 1.2, 0.4, 0.2 };
+  plants.push_back(fast);
+  plants.push_back(dead);
+  plants.push_back(over);
+  plants.push_back(under);
+  return plants;
+}
+
+struct GridPoint
+{
+  unsigned int plant;
+  double kpScale, kiScale;
+  int pOn;
+  double noise;
+};
+
+std::vector<GridPoint> Grid(size_t plants)
+{
+  static const double kpScales[] = { 0.5, 0.7, 1, 1.4, 2 };
+  static const double kiScales[] = { 0.5, 1, 2 };
+  static const double noises[] = { 0, 0.25 };
+  std::vector<GridPoint> grid;
+  for (unsigned int p = 0; p < plants; p++)
+    for (size_t a = 0; a < sizeof(kpScales) / sizeof(*kpScales); a++)
+      for (size_t b = 0; b < sizeof(kiScales) / sizeof(*kiScales); b++)
+        for (int pOn = 0; pOn < 2; pOn++)
+          for (size_t n = 0; n < sizeof(noises) / sizeof(*noises); n++)
+          {
+            GridPoint g = { p, kpScales[a], kiScales[b], pOn ? P_ON_M : P_ON_E, noises[n] };
+            grid.push_back(g);
+          }
+  return grid;
+}
+
+/* Spec(...) **********************************************************************
+ *     SIMC tunings with the closed loop time constant equal to the dead time:
+ *   Kc = tau/(K*2*theta), Ti = min(tau, 8*theta), scaled by the grid point
+ **********************************************************************************/
+LoopSpec Spec(const PlantCase &pc, const GridPoint &g, unsigned long seed)
+{
+  LoopSpec s;
+  s.plant = pc.plant;
+  double kc = pc.tau / (pc.plant.gain * 2 * pc.theta);
+  double ti = pc.tau < 8 * pc.theta ? pc.tau : 8 * pc.theta;
+  s.kp = kc * g.kpScale;
+  s.ki = kc / ti * g.kiScale;
+  s.kd = kc * pc.td * g.kpScale;
+  s.pOn = g.pOn;
+  s.noise = g.noise;
+  s.alpha = g.noise > 0 ? 0.5 : 0;
+  s.seed = seed;
+  s.outMin = 0;
+  s.outMax = 255;
+  s.start = 10;
+  s.setpoint = 60;
+  double settle = 20 * (pc.tau + pc.theta);
+  s.duration = 2 * settle;
+  s.disturbanceAt = settle;
+  s.disturbance = -10;
+  s.sampleTimeUs = pc.theta < 1 ? 50000 : 100000;
+  s.stepUs = 10000;
+  return s;
+}
+
+const char *PonName(int pOn) { return pOn == P_ON_E ? "P_ON_E" : "P_ON_M"; }
+
+void WriteCsv(const char *path, const std::vector<LoopSpec> &specs, const std::vector<LoopMetrics> &m)
+{
+  FILE *f = fopen(path, "w");
+  if (!f) { fprintf(stderr, "can't write %s\n", path); exit(2); }
+  fprintf(f, "loop,kp,ki,kd,pon,noise,iae,ise,itae,overshoot,settling,peak_disturbance,computes\n");
+  for (size_t i = 0; i < specs.size(); i++)
+    fprintf(f, "%zu,%.17g,%.17g,%.17g,%d,%.17g,%.17g,%.17g,%.17g,%.17g,%.17g,%.17g,%lu\n",
+            i, specs[i].kp, specs[i].ki, specs[i].kd, specs[i].pOn, specs[i].noise,
+            m[i].iae, m[i].ise, m[i].itae, m[i].overshoot, m[i].settlingTime, m[i].peakDisturbance,
+            m[i].computes);
+  fclose(f);
+}
+
+bool Close(double a, double b) { return fabs(a - b) <= 1e-9 * (fabs(a) + fabs(b)) + 1e-12; }
+
+//returns the number of loops that differ from the file
+size_t CheckCsv(const char *path, const std::vector<LoopMetrics> &m)
+{
+  FILE *f = fopen(path, "r");
+  if (!f) { fprintf(stderr, "can't read %s\n", path); exit(2); }
+  char line[512];
+  if (!fgets(line, sizeof(line), f)) { fclose(f); return m.size(); }
+  size_t rows = 0, differ = 0;
+  while (fgets(line, sizeof(line), f))
+  {
+    size_t i;
+    double kp, ki, kd, noise, iae, ise, itae, over, settling, peak;
+    int pOn;
+    unsigned long computes;
+    if (sscanf(line, "%zu,%lg,%lg,%lg,%d,%lg,%lg,%lg,%lg,%lg,%lg,%lg,%lu", &i, &kp, &ki, &kd, &pOn,
+               &noise, &iae, &ise, &itae, &over, &settling, &peak, &computes) != 13) continue;
+    rows++;
+    if (i >= m.size()) { differ++; continue; }
+    const LoopMetrics &r = m[i];
+    if (!Close(iae, r.iae) || !Close(ise, r.ise) || !Close(itae, r.itae) || !Close(over, r.overshoot) ||
+        !Close(settling, r.settlingTime) || !Close(peak, r.peakDisturbance) || computes != r.computes)
+    {
+      if (differ < 10) printf("loop %zu: IAE %.6g, was %.6g\n", i, r.iae, iae);
+      differ++;
+    }
+  }
+  fclose(f);
+  if (rows != m.size()) differ += rows > m.size() ? rows - m.size() : m.size() - rows;
+  return differ;
+}
+
+} // namespace
+
+int main(int argc, char **argv)
+{
+  size_t loops = 0;
+  unsigned int threads = 0;
+  const char *csv = 0, *check = 0;
+  for (int a = 1; a < argc; a++)
+  {
+    if (!strcmp(argv[a], "--loops") && a + 1 < argc) loops = strtoul(argv[++a], 0, 10);
+    else if (!strcmp(argv[a], "--threads") && a + 1 < argc) threads = strtoul(argv[++a], 0, 10);
+    else if (!strcmp(argv[a], "--csv") && a + 1 < argc) csv = argv[++a];
+    else if (!strcmp(argv[a], "--check") && a + 1 < argc) check = argv[++a];
+    else
+    {
+      fprintf(stderr, "usage: %s [--loops N] [--threads N] [--csv FILE] [--check FILE]\n", argv[0]);
+      return 2;
+    }
+  }
+
+  std::vector<PlantCase> plants = Plants();
+  std::vector<GridPoint> grid = Grid(plants.size());
+  if (loops == 0) loops = grid.size();
+  std::vector<LoopSpec> specs;
+  specs.reserve(loops);
+  for (size_t i = 0; i < loops; i++)
+  {
+    const GridPoint &g = grid[i % grid.size()];
+    specs.push_back(Spec(plants[g.plant], g, i));
+  }
+
+  std::vector<LoopMetrics> results;
+  std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+  RunLoops(specs, results, threads);
+  double wall = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+  //best tuning per plant by IAE, noise free only, so the rows compare
+  printf("%-18s %-6s %8s %8s %8s %9s %9s %9s %10s %9s\n", "plant", "P on", "Kp", "Ki", "Kd",
+         "IAE", "ISE", "overshoot", "settling", "dist peak");
+  for (unsigned int p = 0; p < plants.size(); p++)
+  {
+    size_t best = specs.size();
+    for (size_t i = 0; i < specs.size() && i < grid.size(); i++)
+      if (grid[i].plant == p && grid[i].noise == 0 && (best == specs.size() || results[i].iae < results[best].iae))
+        best = i;
+    if (best == specs.size()) continue;
+    const LoopSpec &s = specs[best];
+    const LoopMetrics &r = results[best];
+    printf("%-18s %-6s %8.3f %8.4f %8.3f %9.2f %9.1f %8.1f%% %9.1fs %9.2f\n", plants[p].name,
+           PonName(s.pOn), s.kp, s.ki, s.kd, r.iae, r.ise, r.overshoot, r.settlingTime, r.peakDisturbance);
+  }
+
+  unsigned long long steps = 0, computes = 0;
+  double simulated = 0;
+  for (size_t i = 0; i < results.size(); i++)
+  {
+    steps += results[i].steps;
+    computes += results[i].computes;
+    simulated += specs[i].duration;
+  }
+  printf("\n%zu loops, %.0f simulated hours in %.3f s on %u threads\n", specs.size(), simulated / 3600, wall,
+         threads ? threads : std::thread::hardware_concurrency());
+  printf("%.3g loops/s, %.3g simulation steps/s, %.3g PID samples/s\n",
+         specs.size() / wall, steps / wall, computes / wall);
+
+  if (csv) WriteCsv(csv, specs, results);
+  if (check)
+  {
+    size_t differ = CheckCsv(check, results);
+    if (differ)
+    {
+      printf("%zu loops differ from %s\n", differ, check);
+      return 1;
+    }
+    printf("all loops match %s\n", check);
+  }
+  return 0;
+}
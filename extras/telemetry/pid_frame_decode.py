@@ -0,0 +1,116 @@
+#!/usr/bin/env python3
+"""Decode binary PID telemetry frames (see PID_TelemetryFrame.h) into CSV.
+
+usage: pid_frame_decode.py [recording.bin]      (reads stdin if no file is given)
+
+The input can be a raw capture of the serial port, bytes in between frames
+(e.g. text the sketch printed) are skipped.  Frames with a bad CRC are dropped,
+and so are the delta frames after one, after a gap in the sequence numbers and
+before the first key frame: they would be applied to the wrong values.
+Decoding picks up again at the next key frame.
+"""
+import sys
+
+SYNC, KEY, DELTA = 0xA5, 0x01, 0x02
+FIELDS = ("input", "filtered_input", "setpoint", "p", "i", "d", "output")
+
+
+def crc16(data, crc=0xFFFF):
+    for b in data:
+        crc ^= b << 8
+        for _ in range(8):
+            crc = ((crc << 1) ^ 0x1021) if crc & 0x8000 else crc << 1
+            crc &= 0xFFFF
+    return crc
+
+
+def varint(buf, pos):
+    value = shift = 0
+    while True:
+        if pos >= len(buf):
+            raise ValueError("truncated varint")
+        b = buf[pos]
+        pos += 1
+        value |= (b & 0x7F) << shift
+        shift += 7
+        if not b & 0x80:
+            return value, pos
+
+
+def to_int32(v):
+    v &= 0xFFFFFFFF
+    return v - (1 << 32) if v & 0x80000000 else v
+
+
+def frames(data):
+    """Yields the payload (type..last value) of every frame with a valid CRC,
+    and None for every sync byte that doesn't start one.  a sync byte whose
+    length runs past the end is a frame cut off by the end of the recording
+    only if no other sync byte follows, otherwise it was noise."""
+    pos = 0
+    while pos + 4 <= len(data):
+        if data[pos] != SYNC:
+            pos += 1
+            continue
+        length = data[pos + 1]
+        end = pos + 2 + length
+        if end + 2 > len(data):
+            if data.find(bytes([SYNC]), pos + 1) < 0:
+                break
+            yield None
+            pos += 1
+            continue
+        crc = data[end] | (data[end + 1] << 8)
+        if length == 0 or crc16(data[pos + 1:end]) != crc:
+            yield None
+            pos += 1
+            continue
+        yield data[pos + 2:end]
+        pos = end + 2
+
+
+def decode(data):
+    """Yields (time_us, {field: value}) for every sample in the recording."""
+    scale = time = None                 # scale None: waiting for a key frame
+    sequence = 0
+    last = [0] * len(FIELDS)
+    for payload in frames(data):
+        if payload is None:
+            scale = None
+            continue
+        kind, pos = payload[0], 1
+        try:
+            if kind == KEY:
+                scale, pos = varint(payload, pos)
+                if scale == 0:
+                    raise ValueError("key frame with scale 0")
+                time, pos = varint(payload, pos)
+                sequence = 0
+            elif kind == DELTA and scale is not None and len(payload) > 1 and payload[1] == sequence + 1:
+                sequence, pos = payload[1], 2
+                dt, pos = varint(payload, pos)
+                time = (time + dt) & 0xFFFFFFFF
+            else:
+                scale = None
+                continue
+            values = list(last)
+            for i in range(len(FIELDS)):
+                z, pos = varint(payload, pos)
+                d = (z >> 1) ^ -(z & 1)
+                values[i] = d if kind == KEY else to_int32(last[i] + d)
+        except ValueError:
+            scale = None
+            continue
+        last = values
+        yield time, dict(zip(FIELDS, (v / scale for v in last)))
+
+
+def main():
+    data = open(sys.argv[1], "rb").read() if len(sys.argv) > 1 else sys.stdin.buffer.read()
+    print("time_us," + ",".join(FIELDS))
+    for time, values in decode(data):
+        print("%d,%s" % (time, ",".join("%g" % values[f] for f in FIELDS)))
+
+
+if __name__ == "__main__":
+    main()
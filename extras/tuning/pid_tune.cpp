@@ -0,0 +1,418 @@
+/**********************************************************************************
+ * Offline tuning from plant models
+ *
+ *    finds tunings for each operating point of a list of identified plant
+ *  models and prints them as a PIDGainPoint table for PID_Schedule.h.  per
+ *  operating point it sweeps a grid of Kp, Ki, Kd and smoothing factors around
+ *  the SIMC tunings of the model, then refines the best one with Nelder-Mead.
+ *  every candidate is a closed loop simulation (a setpoint step, then a load
+ *  step) scored by IAE, ISE or ITAE, with a penalty for overshoot above
+ *  --max-overshoot.
+ *
+ *  the simulations run in batches of 8 on the channels of a PIDBank (see
+ *  RunBatch() in pid_sim.h), and the batches of all operating points go
+ *  through one work-stealing pool, so the points with slow plants don't hold
+ *  up the cores.  Nelder-Mead evaluates its reflection, expansion and both
+ *  contractions together as one batch.
+ *
+ *  usage: pid_tune MODELS [options]
+ *
+ *    --objective iae|ise|itae   what to minimize (default itae)
+ *    --sample-ms N              the PID's sample time (default 100)
+ *    --step X                   size of the setpoint step (default 10)
+ *    --disturbance U            size of the load step, in output units (default -10)
+ *    --limits MIN MAX           output limits (default 0 255)
+ *    --max-overshoot P          overshoot in % that is free (default 5)
+ *    --grid N                   grid points per gain (default 8)
+ *    --alpha A,B,...            smoothing factors to try (default 0)
+ *    --pi                       no D part
+ *    --pon-m                    tune for P_ON_M instead of P_ON_E
+ *    --iterations N             Nelder-Mead iterations per point (default 80)
+ *    --threads N                default one per core
+ *    --name NAME                name of the table (default gains)
+ *
+ *  MODELS has one operating point per line, in order of X:
+ *
+ *      # fopdt X U0 K Tau DeadTime
+ *      # sopdt X U0 K Wn Zeta DeadTime
+ *      fopdt   50   20   2.4   180   20
+ *      sopdt  200  120   1.6  0.02  0.9   25
+ *
+ *  X is the operating point the schedule looks up, U0 the output that holds
+ *  the process there, times are in seconds.
+ **********************************************************************************/
+
+#include "pid_sim.h"
+#include "work_pool.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+
+namespace {
+
+const unsigned int Batch = 8;           // loops per PIDBank
+
+enum Objective { IAE, ISE, ITAE };
+
+struct Options
+{
+  Objective objective = ITAE;
+  unsigned long sampleTimeUs = 100000;
+  double step = 10;
+  double disturbance = -10;
+  double outMin = 0, outMax = 255;
+  double maxOvershoot = 5;
+  unsigned int grid = 8;
+  std::vector<double> alphas = std::vector<double>(1, 0.0);
+  bool useD = true;
+  int pOn = P_ON_E;
+  unsigned int iterations = 80;
+  unsigned int threads = 0;
+  const char *name = "gains";
+};
+
+struct Model
+{
+  double x, u0;
+  SimPlant plant;
+  double tau, theta, td;                // FOPDT approximation, for the starting point and the run length
+};
+
+struct Candidate
+{
+  double kp, ki, kd, alpha;
+  double cost;
+  LoopMetrics metrics;
+};
+
+std::atomic<unsigned long long> simulations(0);
+
+bool ParseModels(const char *path, std::vector<Model> &models)
+{
+  FILE *f = fopen(path, "r");
+  if (!f) { fprintf(stderr, "can't read %s\n", path); return false; }
+  char line[256];
+  int n = 0;
+  while (fgets(line, sizeof(line), f))
+  {
+    n++;
+    char type[16];
+    double v[6];
+    if (sscanf(line, " %15s", type) != 1 || type[0] == '#') continue;
+    Model m;
+    if (!strcmp(type, "fopdt") && sscanf(line, " %*s %lg %lg %lg %lg %lg", &v[0], &v[1], &v[2], &v[3], &v[4]) == 5)
+    {
+      m.plant = SimPlant::FOPDT(v[2], v[3], v[4]);
+      m.tau = v[3];
+      m.theta = v[4];
+      m.td = 0;
+    }
+    else if (!strcmp(type, "sopdt") &&
+             sscanf(line, " %*s %lg %lg %lg %lg %lg %lg", &v[0], &v[1], &v[2], &v[3], &v[4], &v[5]) == 6)
+    {
+      m.plant = SimPlant::SOPDT(v[2], v[3], v[4], v[5]);
+      //time constants of the two poles, the half rule splits the smaller one
+      //between the dead time and Td.  underdamped: 2*zeta/wn and 0
+      double zeta = v[4], wn = v[3];
+      double tau1 = 2 * zeta / wn, tau2 = 0;
+      if (zeta > 1)
+      {
+         double r = sqrt(zeta * zeta - 1);
+         tau1 = 1 / (wn * (zeta - r));
+         tau2 = 1 / (wn * (zeta + r));
+      }
+      m.tau = tau1 + tau2 / 2;
+      m.theta = v[5] + tau2 / 2;
+      m.td = tau2;
+    }
+    else
+    {
+      fprintf(stderr, "%s:%d: can't read this model\n", path, n);
+      fclose(f);
+      return false;
+    }
+    if (m.theta <= 0) m.theta = m.tau / 20;
+    m.x = v[0];
+    m.u0 = v[1];
+    models.push_back(m);
+  }
+  fclose(f);
+  return true;
+}
+
+/* BaseSpec(...) ******************************************************************
+ *     the process starts settled at U0.  the simulation works on K*U0 instead of
+ *   X, the PID only sees differences, so that gives the same loop
+ **********************************************************************************/
+LoopSpec BaseSpec(const Model &m, const Options &o)
+{
+  LoopSpec s;
+  s.plant = m.plant;
+  s.pOn = o.pOn;
+  s.sampleTimeUs = o.sampleTimeUs;
+  s.stepUs = o.sampleTimeUs / 4 ? o.sampleTimeUs / 4 : 1;
+  s.outMin = o.outMin;
+  s.outMax = o.outMax;
+  s.start = m.plant.gain * m.u0;
+  s.setpoint = s.start + o.step;
+  double settle = 10 * (m.tau + m.theta);
+  s.disturbanceAt = settle;
+  s.disturbance = o.disturbance;
+  s.duration = 2 * settle;
+  return s;
+}
+
+double Cost(const LoopMetrics &m, const Options &o)
+{
+  double c = o.objective == IAE ? m.iae : o.objective == ISE ? m.ise : m.itae;
+  double over = m.overshoot - o.maxOvershoot;
+  return over > 0 ? c * (1 + over * over / 25) : c;
+}
+
+//simulates n candidates in batches of Batch loops
+void Evaluate(Candidate *c, size_t n, const Model &m, const Options &o)
+{
+  LoopSpec specs[Batch];
+  LoopMetrics metrics[Batch];
+  for (size_t first = 0; first < n; first += Batch)
+  {
+    unsigned int k = (unsigned int)std::min<size_t>(Batch, n - first);
+    for (unsigned int j = 0; j < k; j++)
+    {
+      specs[j] = BaseSpec(m, o);
+      specs[j].kp = c[first + j].kp;
+      specs[j].ki = c[first + j].ki;
+      specs[j].kd = c[first + j].kd;
+      specs[j].alpha = c[first + j].alpha;
+    }
+    RunBatch<Batch, double>(specs, k, metrics);
+    for (unsigned int j = 0; j < k; j++)
+    {
+      c[first + j].metrics = metrics[j];
+      c[first + j].cost = Cost(metrics[j], o);
+    }
+    simulations += k;
+  }
+}
+
+/* GridSearch(...) ****************************************************************
+ *     Kp from 1/4 to 4 times the SIMC gain Kc = tau/(K*2*theta), Ki around Kc/Ti
+ *   with Ti = min(tau, 8*theta) and Kd from 0 to 2*Kc*max(Td, theta/2), all on
+ *   log scales, for each smoothing factor.  every Batch candidates are a task
+ **********************************************************************************/
+Candidate GridSearch(WorkPool &pool, const Model &m, const Options &o)
+{
+  double kc = m.tau / (fabs(m.plant.gain) * 2 * m.theta);
+  double ti = std::min(m.tau, 8 * m.theta);
+  double kdRef = 2 * kc * std::max(m.td, m.theta / 2);
+  unsigned int g = o.grid > 1 ? o.grid : 2;
+
+  std::vector<Candidate> grid;
+  for (size_t a = 0; a < o.alphas.size(); a++)
+    for (unsigned int i = 0; i < g; i++)
+      for (unsigned int j = 0; j < g; j++)
+        for (unsigned int k = 0; k < (o.useD ? g : 1); k++)
+        {
+          Candidate c;
+          c.kp = kc * pow(16, double(i) / (g - 1)) / 4;
+          c.ki = kc / ti * pow(16, double(j) / (g - 1)) / 4;
+          c.kd = k == 0 ? 0 : kdRef * pow(16, double(k - 1) / (g - 1)) / 8;
+          c.alpha = o.alphas[a];
+          grid.push_back(c);
+        }
+
+  WorkPool::Group group;
+  for (size_t first = 0; first < grid.size(); first += Batch)
+  {
+    Candidate *c = &grid[first];
+    size_t n = std::min<size_t>(Batch, grid.size() - first);
+    pool.Run(group, [c, n, &m, &o]() { Evaluate(c, n, m, o); });
+  }
+  pool.Wait(group);
+
+  size_t best = 0;
+  for (size_t i = 1; i < grid.size(); i++)
+    if (grid[i].cost < grid[best].cost) best = i;
+  return grid[best];
+}
+
+/* NelderMead(...) ****************************************************************
+ *     on log(Kp), log(Ki) and, with a D part, Kd/Kd0 (which can reach 0).  the
+ *   smoothing factor stays what the grid found.  one iteration evaluates the
+ *   reflection, the expansion and both contractions in one batch, whichever of
+ *   them the step then takes; a shrink evaluates the whole simplex
+ **********************************************************************************/
+struct Point
+{
+  double v[3];
+  Candidate c;
+};
+
+Candidate NelderMead(const Candidate &start, const Model &m, const Options &o)
+{
+  const unsigned int dims = o.useD ? 3 : 2;
+  double kd0 = start.kd > 0 ? start.kd : 2 * start.kp * std::max(m.td, m.theta / 2) / 8;
+
+  auto toCandidate = [&](const double *v) {
+    Candidate c;
+    c.kp = exp(v[0]);
+    c.ki = exp(v[1]);
+    c.kd = dims == 3 && v[2] > 0 ? v[2] * kd0 : 0;
+    c.alpha = start.alpha;
+    return c;
+  };
+
+  Point simplex[4];
+  Candidate batch[Batch];
+  for (unsigned int i = 0; i <= dims; i++)
+  {
+    simplex[i].v[0] = log(start.kp);
+    simplex[i].v[1] = log(start.ki);
+    simplex[i].v[2] = start.kd / kd0;
+    if (i > 0) simplex[i].v[i - 1] += i == 3 ? 0.5 : 0.3;
+    batch[i] = toCandidate(simplex[i].v);
+  }
+  Evaluate(batch, dims + 1, m, o);
+  for (unsigned int i = 0; i <= dims; i++) simplex[i].c = batch[i];
+
+  auto byCost = [](const Point &a, const Point &b) { return a.c.cost < b.c.cost; };
+  for (unsigned int it = 0; it < o.iterations; it++)
+  {
+    std::sort(simplex, simplex + dims + 1, byCost);
+    Point &worst = simplex[dims];
+    double spread = 0;
+    for (unsigned int i = 1; i <= dims; i++)
+      for (unsigned int d = 0; d < dims; d++) spread = std::max(spread, fabs(simplex[i].v[d] - simplex[0].v[d]));
+    if (spread < 1e-3) break;
+
+    double centroid[3] = { 0, 0, 0 };
+    for (unsigned int i = 0; i < dims; i++)
+      for (unsigned int d = 0; d < dims; d++) centroid[d] += simplex[i].v[d] / dims;
+
+    //reflection, expansion, outside and inside contraction
+    static const double factors[4] = { 1, 2, 0.5, -0.5 };
+    Point trial[4];
+    for (unsigned int t = 0; t < 4; t++)
+    {
+      for (unsigned int d = 0; d < 3; d++)
+        trial[t].v[d] = d < dims ? centroid[d] + factors[t] * (centroid[d] - worst.v[d]) : 0;
+      batch[t] = toCandidate(trial[t].v);
+    }
+    Evaluate(batch, 4, m, o);
+    for (unsigned int t = 0; t < 4; t++) trial[t].c = batch[t];
+
+    const Point &r = trial[0], &e = trial[1], &oc = trial[2], &ic = trial[3];
+    if (r.c.cost < simplex[0].c.cost) worst = e.c.cost < r.c.cost ? e : r;
+    else if (r.c.cost < simplex[dims - 1].c.cost) worst = r;
+    else if (r.c.cost < worst.c.cost && oc.c.cost <= r.c.cost) worst = oc;
+    else if (r.c.cost >= worst.c.cost && ic.c.cost < worst.c.cost) worst = ic;
+    else
+    {
+      //shrink towards the best
+      for (unsigned int i = 1; i <= dims; i++)
+      {
+        for (unsigned int d = 0; d < dims; d++) simplex[i].v[d] = (simplex[i].v[d] + simplex[0].v[d]) / 2;
+        batch[i - 1] = toCandidate(simplex[i].v);
+      }
+      Evaluate(batch, dims, m, o);
+      for (unsigned int i = 1; i <= dims; i++) simplex[i].c = batch[i - 1];
+    }
+  }
+  std::sort(simplex, simplex + dims + 1, byCost);
+  return simplex[0].c.cost < start.cost ? simplex[0].c : start;
+}
+
+std::vector<double> ParseList(const char *s)
+{
+  std::vector<double> v;
+  while (*s)
+  {
+    char *end;
+    v.push_back(strtod(s, &end));
+    if (end == s) break;
+    s = *end == ',' ? end + 1 : end;
+  }
+  return v;
+}
+
+int Usage(const char *self)
+{
+  fprintf(stderr, "usage: %s MODELS [--objective iae|ise|itae] [--sample-ms N] [--step X] [--disturbance U]\n"
+                  "       [--limits MIN MAX] [--max-overshoot P] [--grid N] [--alpha A,B,...] [--pi] [--pon-m]\n"
+                  "       [--iterations N] [--threads N] [--name NAME]\n", self);
+  return 2;
+}
+
+} // namespace
+
+int main(int argc, char **argv)
+{
+  if (argc < 2) return Usage(argv[0]);
+  Options o;
+  for (int a = 2; a < argc; a++)
+  {
+    const char *arg = argv[a];
+    bool more = a + 1 < argc;
+    if (!strcmp(arg, "--objective") && more)
+    {
+      const char *v = argv[++a];
+      if (!strcmp(v, "iae")) o.objective = IAE;
+      else if (!strcmp(v, "ise")) o.objective = ISE;
+      else if (!strcmp(v, "itae")) o.objective = ITAE;
+      else return Usage(argv[0]);
+    }
+    else if (!strcmp(arg, "--sample-ms") && more) o.sampleTimeUs = (unsigned long)(atof(argv[++a]) * 1000);
+    else if (!strcmp(arg, "--step") && more) o.step = atof(argv[++a]);
+    else if (!strcmp(arg, "--disturbance") && more) o.disturbance = atof(argv[++a]);
+    else if (!strcmp(arg, "--limits") && a + 2 < argc) { o.outMin = atof(argv[++a]); o.outMax = atof(argv[++a]); }
+    else if (!strcmp(arg, "--max-overshoot") && more) o.maxOvershoot = atof(argv[++a]);
+    else if (!strcmp(arg, "--grid") && more) o.grid = strtoul(argv[++a], 0, 10);
+    else if (!strcmp(arg, "--alpha") && more) o.alphas = ParseList(argv[++a]);
+    else if (!strcmp(arg, "--pi")) o.useD = false;
+    else if (!strcmp(arg, "--pon-m")) o.pOn = P_ON_M;
+    else if (!strcmp(arg, "--iterations") && more) o.iterations = strtoul(argv[++a], 0, 10);
+    else if (!strcmp(arg, "--threads") && more) o.threads = strtoul(argv[++a], 0, 10);
+    else if (!strcmp(arg, "--name") && more) o.name = argv[++a];
+    else return Usage(argv[0]);
+  }
+  if (o.sampleTimeUs == 0 || o.alphas.empty() || o.outMin >= o.outMax) return Usage(argv[0]);
+
+  std::vector<Model> models;
+  if (!ParseModels(argv[1], models)) return 2;
+  if (models.empty()) { fprintf(stderr, "no models in %s\n", argv[1]); return 2; }
+
+  std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+  WorkPool pool(o.threads);
+  std::vector<Candidate> results(models.size());
+  WorkPool::Group group;
+  for (size_t i = 0; i < models.size(); i++)
+    pool.Run(group, [&, i]() {
+      Candidate best = GridSearch(pool, models[i], o);
+      results[i] = NelderMead(best, models[i], o);
+    });
+  pool.Wait(group);
+  double wall = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+  static const char *objectives[] = { "IAE", "ISE", "ITAE" };
+  printf("// pid_tune %s: %s, sample time %g ms, %s%s\n", argv[1], objectives[o.objective],
+         o.sampleTimeUs / 1000.0, o.pOn == P_ON_E ? "P_ON_E" : "P_ON_M", o.useD ? "" : ", PI");
+  printf("const PIDGainPoint %s[] PROGMEM = {\n", o.name);
+  printf("  //       X            Kp           Ki           Kd\n");
+  for (size_t i = 0; i < models.size(); i++)
+  {
+    const Candidate &c = results[i];
+    printf("  { %#10.6gf, %#11.6gf, %#11.6gf, %#11.6gf },  // %s %.4g, overshoot %.1f%%, settling %.1fs, alpha %g\n",
+           models[i].x, c.kp, c.ki, c.kd, objectives[o.objective],
+           o.objective == IAE ? c.metrics.iae : o.objective == ISE ? c.metrics.ise : c.metrics.itae,
+           c.metrics.overshoot, c.metrics.settlingTime, c.alpha);
+  }
+  printf("};\n");
+  fprintf(stderr, "%llu simulations in %.2f s on %u threads (%.3g/s, %lu steals)\n",
+          (unsigned long long)simulations, wall, pool.Size(), simulations / wall, pool.GetSteals());
+  return 0;
+}
@@ -0,0 +1,122 @@
+#include "work_pool.h"
+
+namespace {
+//the pool and queue the current thread works on, no pool outside the workers and Wait()
+thread_local const WorkPool *currentPool = 0;
+thread_local unsigned int currentQueue = 0;
+}
+
+WorkPool::WorkPool(unsigned int Threads) : queued(0), steals(0), stop(false)
+{
+   if (Threads == 0) Threads = std::thread::hardware_concurrency();
+   if (Threads == 0) Threads = 1;
+   for (unsigned int i = 0; i < Threads; i++) queues.push_back(std::unique_ptr<Queue>(new Queue));
+   for (unsigned int i = 0; i + 1 < Threads; i++) threads.push_back(std::thread(&WorkPool::Worker, this, i));
+}
+
+WorkPool::~WorkPool()
+{
+   {
+      std::lock_guard<std::mutex> l(sleepLock);
+      stop = true;
+   }
+   wake.notify_all();
+   for (size_t i = 0; i < threads.size(); i++) threads[i].join();
+}
+
+unsigned int WorkPool::Self() const
+{
+   return currentPool == this ? currentQueue : (unsigned int)queues.size() - 1;
+}
+
+void WorkPool::Run(Group &group, std::function<void()> run)
+{
+   group.pending++;
+   Queue &q = *queues[Self()];
+   {
+      std::lock_guard<std::mutex> l(q.lock);
+      Task t = { run, &group };
+      q.tasks.push_back(t);
+   }
+   {
+      std::lock_guard<std::mutex> l(sleepLock);  //so a worker can't miss it between its check and its wait
+      queued++;
+   }
+   wake.notify_one();
+}
+
+/* RunOne(...) **********************************************************************
+ *     the newest task of our own queue, or else the oldest of the next queue that
+ *   has one, starting with our neighbour so the thieves spread out
+ **********************************************************************************/
+bool WorkPool::RunOne(unsigned int self)
+{
+   Task task;
+   bool found = false;
+   {
+      Queue &q = *queues[self];
+      std::lock_guard<std::mutex> l(q.lock);
+      if (!q.tasks.empty())
+      {
+         task = q.tasks.back();
+         q.tasks.pop_back();
+         found = true;
+      }
+   }
+   for (size_t k = 1; !found && k < queues.size(); k++)
+   {
+      Queue &q = *queues[(self + k) % queues.size()];
+      std::lock_guard<std::mutex> l(q.lock);
+      if (!q.tasks.empty())
+      {
+         task = q.tasks.front();
+         q.tasks.pop_front();
+         found = true;
+         steals++;
+      }
+   }
+   if (!found) return false;
+
+   queued--;
+   task.run();
+   {
+      std::lock_guard<std::mutex> l(sleepLock);
+      task.group->pending--;
+   }
+   wake.notify_all();                   // someone may be waiting for this group
+   return true;
+}
+
+void WorkPool::Worker(unsigned int self)
+{
+   currentPool = this;
+   currentQueue = self;
+   while (!stop)
+   {
+      if (RunOne(self)) continue;
+      std::unique_lock<std::mutex> l(sleepLock);
+      wake.wait(l, [this]() { return stop || queued > 0; });
+   }
+}
+
+/* Wait(...) ************************************************************************
+ *     helps with any task while the group isn't done.  with nothing left to run
+ *   the group's last tasks are running on other threads, so it sleeps until
+ *   one of them finishes
+ **********************************************************************************/
+void WorkPool::Wait(Group &group)
+{
+   unsigned int self = Self();
+   const WorkPool *outerPool = currentPool;
+   unsigned int outerQueue = currentQueue;
+   currentPool = this;
+   currentQueue = self;
+   while (group.pending > 0)
+   {
+      if (RunOne(self)) continue;
+      std::unique_lock<std::mutex> l(sleepLock);
+      wake.wait(l, [&]() { return group.pending == 0 || queued > 0; });
+   }
+   currentPool = outerPool;
+   currentQueue = outerQueue;
+}
@@ -0,0 +1,75 @@
+#ifndef PID_WorkPool_h
+#define PID_WorkPool_h
+
+/**********************************************************************************
+ * WorkPool
+ *
+ *    a work-stealing thread pool for the tuning jobs.  every thread has its
+ *  own queue: it runs the newest task of its own queue first (what it just
+ *  split off, still warm in the cache), and when that is empty it steals the
+ *  oldest task of another queue (the biggest piece of work left there).
+ *  tasks can add tasks, and Wait() on a group runs tasks until all of the
+ *  group's are done, so a task that waits for its subtasks keeps its thread
+ *  busy instead of blocking it:
+ *
+ *      WorkPool pool;                    //one thread per core, this one included
+ *      WorkPool::Group group;
+ *      for (...) pool.Run(group, [=]() { ... });
+ *      pool.Wait(group);
+ **********************************************************************************/
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+class WorkPool
+{
+public:
+  class Group
+  {
+  public:
+    Group() : pending(0) {}
+  private:
+    friend class WorkPool;
+    std::atomic<size_t> pending;
+  };
+
+  explicit WorkPool(unsigned int Threads = 0);   // * 0 = one per core.  the thread calling
+  ~WorkPool();                                   //   Wait() counts as one of them
+
+  void Run(Group&, std::function<void()>);       // * queues a task on the calling thread's queue
+  void Wait(Group&);                             // * runs tasks until the group's are all done
+  unsigned int Size() const { return (unsigned int)queues.size(); }
+  unsigned long GetSteals() const { return steals; }
+
+private:
+  struct Task
+  {
+    std::function<void()> run;
+    Group *group;
+  };
+  struct Queue
+  {
+    std::mutex lock;
+    std::deque<Task> tasks;
+  };
+
+  bool RunOne(unsigned int self);       // * one task, own queue first, then stolen.  false if none
+  void Worker(unsigned int self);
+  unsigned int Self() const;
+
+  std::vector<std::unique_ptr<Queue> > queues;   // the last one belongs to the threads outside the pool
+  std::vector<std::thread> threads;
+  std::mutex sleepLock;
+  std::condition_variable wake;
+  std::atomic<size_t> queued;
+  std::atomic<unsigned long> steals;
+  std::atomic<bool> stop;
+};
+
+#endif